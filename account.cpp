@@ -1,33 +1,112 @@
 #include "account.hpp"
 #include "utils.hpp"
 #include <sstream>
+#include <stdexcept>
 #include <algorithm>
 
 Account::Account() : outstandingFine(0.0) {}
 
-bool Account::addBorrowedBook(const std::string& bookId) {
+bool Account::addBorrowedBook(Id bookId) {
+    return addBorrowedBook(bookId, Utils::getCurrentTime());
+}
+
+bool Account::addBorrowedBook(Id bookId, std::time_t borrowDate) {
     currentlyBorrowedBooks.push_back(bookId);
-    BorrowRecord record{bookId, Utils::getCurrentTime(), 0};
+    BorrowRecord record{bookId, borrowDate, 0};
     borrowHistory.push_back(record);
+    openLoanIndex[bookId] = borrowHistory.size() - 1;
+    openLoansByDate.emplace(borrowDate, bookId);
+    return true;
+}
+
+bool Account::returnBook(Id bookId) {
+    return returnBook(bookId, Utils::getCurrentTime());
+}
+
+bool Account::returnBook(Id bookId, std::time_t returnDate) {
+    auto loan = openLoanIndex.find(bookId);
+    if (loan == openLoanIndex.end()) {
+        return false;
+    }
+    if (loan->second != NO_RECORD) {
+        BorrowRecord& record = borrowHistory[loan->second];
+        openLoansByDate.erase({record.borrowDate, bookId});
+        record.returnDate = returnDate;
+    }
+    openLoanIndex.erase(loan);
+
+    // Bounded by the role's borrowing limit, so this stays a handful of entries
+    currentlyBorrowedBooks.erase(std::find(currentlyBorrowedBooks.begin(),
+                                           currentlyBorrowedBooks.end(), bookId));
+    return true;
+}
+
+std::vector<BorrowRecord> Account::trimHistory(std::size_t keep) {
+    std::vector<std::size_t> closed;
+    for (std::size_t i = 0; i < borrowHistory.size(); ++i) {
+        if (borrowHistory[i].returnDate != 0) closed.push_back(i);
+    }
+    std::vector<BorrowRecord> trimmed;
+    if (closed.size() <= keep) return trimmed;
+
+    // Keep the most recently returned loans; open ones always stay
+    std::size_t excess = closed.size() - keep;
+    std::nth_element(closed.begin(), closed.begin() + excess, closed.end(),
+                     [this](std::size_t a, std::size_t b) {
+                         return borrowHistory[a].returnDate != borrowHistory[b].returnDate
+                                    ? borrowHistory[a].returnDate < borrowHistory[b].returnDate
+                                    : a < b;
+                     });
+    std::vector<bool> drop(borrowHistory.size(), false);
+    for (std::size_t i = 0; i < excess; ++i) drop[closed[i]] = true;
+
+    std::vector<BorrowRecord> kept;
+    kept.reserve(borrowHistory.size() - excess);
+    trimmed.reserve(excess);
+    for (std::size_t i = 0; i < borrowHistory.size(); ++i) {
+        (drop[i] ? trimmed : kept).push_back(std::move(borrowHistory[i]));
+    }
+    borrowHistory.swap(kept);
+    reindexOpenLoans();
+    return trimmed;
+}
+
+bool Account::getOpenLoanDate(Id bookId, std::time_t& borrowDate) const {
+    auto loan = openLoanIndex.find(bookId);
+    if (loan == openLoanIndex.end() || loan->second == NO_RECORD) return false;
+    borrowDate = borrowHistory[loan->second].borrowDate;
+    return true;
+}
+
+double Account::getAccruedFine(Id bookId) const {
+    auto loan = openLoanIndex.find(bookId);
+    if (loan == openLoanIndex.end() || loan->second == NO_RECORD) return 0.0;
+    return borrowHistory[loan->second].accruedFine;
+}
+
+bool Account::setAccruedFine(Id bookId, double amount) {
+    auto loan = openLoanIndex.find(bookId);
+    if (loan == openLoanIndex.end() || loan->second == NO_RECORD) return false;
+    borrowHistory[loan->second].accruedFine = amount;
     return true;
 }
 
-bool Account::returnBook(const std::string& bookId) {
-    auto it = std::find(currentlyBorrowedBooks.begin(), 
-                       currentlyBorrowedBooks.end(), bookId);
-    if (it != currentlyBorrowedBooks.end()) {
-        currentlyBorrowedBooks.erase(it);
-
-        // Update return date in history
-        for (auto& record : borrowHistory) {
-            if (record.bookId == bookId && record.returnDate == 0) {
-                record.returnDate = Utils::getCurrentTime();
-                break;
+void Account::reindexOpenLoans() {
+    openLoanIndex.clear();
+    openLoansByDate.clear();
+    for (const auto& bookId : currentlyBorrowedBooks) {
+        openLoanIndex[bookId] = NO_RECORD;
+    }
+    for (std::size_t i = 0; i < borrowHistory.size(); ++i) {
+        auto loan = openLoanIndex.find(borrowHistory[i].bookId);
+        if (borrowHistory[i].returnDate == 0 && loan != openLoanIndex.end()) {
+            if (loan->second != NO_RECORD) {
+                openLoansByDate.erase({borrowHistory[loan->second].borrowDate, loan->first});
             }
+            loan->second = i;
+            openLoansByDate.emplace(borrowHistory[i].borrowDate, loan->first);
         }
-        return true;
     }
-    return false;
 }
 
 std::string Account::serialize() const {
@@ -47,7 +126,11 @@ std::string Account::serialize() const {
     for (const auto& record : borrowHistory) {
         ss << record.bookId << "," 
            << record.borrowDate << "," 
-           << record.returnDate << ";";
+           << record.returnDate;
+        if (record.accruedFine > 0) {
+            ss << "," << record.accruedFine;
+        }
+        ss << ";";
     }
 
     return ss.str();
@@ -55,45 +138,77 @@ std::string Account::serialize() const {
 
 Account Account::deserialize(const std::string& data) {
     Account account;
-    std::stringstream ss(data);
-    std::string segment;
+    ParseError error;
+    if (!parse(data, account, error)) {
+        throw std::invalid_argument("Account::deserialize: " + error.describe());
+    }
+    return account;
+}
 
-    // Get fine
-    std::getline(ss, segment, ';');
-    account.outstandingFine = std::stod(segment);
+// Format: fine;count;id,id,;count;bookId,borrowDate,returnDate[,accruedFine];...
+bool Account::parse(std::string_view data, Account& account, ParseError& error) {
+    FieldReader reader(data);
+    std::string_view segment;
+
+    if (!reader.next(';', segment) || !parseNumber(segment, account.outstandingFine)) {
+        return parseFailure(error, "fine", "expected a number");
+    }
 
-    // Get currently borrowed books
-    std::getline(ss, segment, ';');
-    int currentSize = std::stoi(segment);
-    std::getline(ss, segment, ';');
+    // Currently borrowed books
+    int currentSize = 0;
+    if (!reader.next(';', segment) || !parseNumber(segment, currentSize) || currentSize < 0) {
+        return parseFailure(error, "borrowed count", "expected a non-negative integer");
+    }
+    if (!reader.next(';', segment)) {
+        return parseFailure(error, "borrowed books", "missing");
+    }
     if (currentSize > 0) {
-        std::stringstream bookSS(segment);
-        std::string bookId;
-        while (std::getline(bookSS, bookId, ',')) {
-            if (!bookId.empty()) {
-                account.currentlyBorrowedBooks.push_back(bookId);
+        // Counts come from the file; never reserve past what the bytes can hold
+        account.currentlyBorrowedBooks.reserve(
+            std::min<std::size_t>(currentSize, segment.size() / 2 + 1));  // "x,"
+        FieldReader books(segment);
+        std::string_view bookId;
+        while (books.next(',', bookId)) {
+            if (bookId.empty()) continue;
+            Id parsed;
+            if (!Id::parse(bookId, parsed)) {
+                return parseFailure(error, "borrowed books", "malformed book ID");
             }
+            account.currentlyBorrowedBooks.push_back(parsed);
         }
     }
 
-    // Get borrow history
-    std::getline(ss, segment, ';');
-    int historySize = std::stoi(segment);
+    // Borrow history
+    int historySize = 0;
+    if (!reader.next(';', segment) || !parseNumber(segment, historySize) || historySize < 0) {
+        return parseFailure(error, "history count", "expected a non-negative integer");
+    }
+    account.borrowHistory.reserve(
+        std::min<std::size_t>(historySize, reader.rest().size() / 6 + 1));  // "x,0,0;"
     for (int i = 0; i < historySize; ++i) {
-        std::getline(ss, segment, ';');
-        std::stringstream recordSS(segment);
-        std::string bookId, borrowDate, returnDate;
-        std::getline(recordSS, bookId, ',');
-        std::getline(recordSS, borrowDate, ',');
-        std::getline(recordSS, returnDate, ',');
-
-        BorrowRecord record{
-            bookId,
-            static_cast<std::time_t>(std::stoll(borrowDate)),
-            static_cast<std::time_t>(std::stoll(returnDate))
-        };
-        account.borrowHistory.push_back(record);
+        if (!reader.next(';', segment)) {
+            return parseFailure(error, "history", "fewer records than its count");
+        }
+        FieldReader record(segment);
+        std::string_view bookId, borrowDate, returnDate, accruedFine;
+        Id parsedBookId;
+        long long borrowed = 0;
+        long long returned = 0;
+        double accrued = 0.0;
+        if (!record.next(',', bookId) || !Id::parse(bookId, parsedBookId) ||
+            !record.next(',', borrowDate) || !parseNumber(borrowDate, borrowed) ||
+            !record.next(',', returnDate) || !parseNumber(returnDate, returned)) {
+            return parseFailure(error, "history", "expected bookId,borrowDate,returnDate");
+        }
+        if (record.next(',', accruedFine) && !parseNumber(accruedFine, accrued)) {
+            return parseFailure(error, "history", "expected a number for the accrued fine");
+        }
+        account.borrowHistory.push_back(BorrowRecord{
+            parsedBookId,
+            static_cast<std::time_t>(borrowed),
+            static_cast<std::time_t>(returned),
+            accrued});
     }
-
-    return account;
-}
\ No newline at end of file
+    account.reindexOpenLoans();
+    return true;
+}
@@ -1,16 +1,24 @@
 #ifndef ACCOUNT_HPP
 #define ACCOUNT_HPP
 
+#include <cstddef>
+#include <set>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 #include <ctime>
 #include <iostream>
+#include "id.hpp"
+#include "record_parser.hpp"
 
 // Encapsulation: Struct for record keeping
 struct BorrowRecord {
-    std::string bookId;
+    Id bookId;
     std::time_t borrowDate;
     std::time_t returnDate;
+    double accruedFine = 0.0;  // overdue fine already charged while still open
 
     void print() const {
         std::cout << "Book ID: " << bookId << std::endl;
@@ -26,19 +34,48 @@ struct BorrowRecord {
 class Account {
 private:
     // Encapsulation: Private data members
-    std::vector<std::string> currentlyBorrowedBooks;
-    std::vector<BorrowRecord> borrowHistory;
+    std::vector<Id> currentlyBorrowedBooks;
+    std::vector<BorrowRecord> borrowHistory;  // open loans plus recent closed ones
     double outstandingFine;
 
+    // Open loans: book ID -> position in borrowHistory (NO_RECORD for a
+    // loan without a history entry), so returns don't scan the history
+    std::unordered_map<Id, std::size_t> openLoanIndex;
+    static const std::size_t NO_RECORD = static_cast<std::size_t>(-1);
+    // The same dated loans as (borrowDate, bookId), earliest first. Every
+    // loan of an account has the same loan period, so this is due-date order.
+    std::set<std::pair<std::time_t, Id>> openLoansByDate;
+    void reindexOpenLoans();
+
+    // Fines change only through Library, which keeps the fines ledger in step
+    void addFine(double amount) { outstandingFine += amount; }
+    void clearFine() { outstandingFine = 0; }
+    void updateFine(double newFine) { outstandingFine = newFine; }
+
 public:
+    // Closed loans kept inline; older ones are trimmed into the archive
+    static const std::size_t RECENT_HISTORY = 10;
+
     Account();
 
     // Encapsulation: Public methods for controlled access
-    bool addBorrowedBook(const std::string& bookId);
-    bool returnBook(const std::string& bookId);
+    bool addBorrowedBook(Id bookId);
+    bool addBorrowedBook(Id bookId, std::time_t borrowDate);
+    bool returnBook(Id bookId);
+    bool returnBook(Id bookId, std::time_t returnDate);
+    bool hasOpenLoan(Id bookId) const { return openLoanIndex.count(bookId) > 0; }
+    bool getOpenLoanDate(Id bookId, std::time_t& borrowDate) const;
+    // Borrow date of the loan due first; 0 without dated open loans
+    std::time_t getOldestOpenLoanDate() const {
+        return openLoansByDate.empty() ? 0 : openLoansByDate.begin()->first;
+    }
+    // Fine charged so far on an open loan by overdue accrual
+    double getAccruedFine(Id bookId) const;
+    bool setAccruedFine(Id bookId, double amount);
+    const std::set<std::pair<std::time_t, Id>>& getOpenLoansByDate() const {
+        return openLoansByDate;
+    }
     bool hasFine() const { return outstandingFine > 0; }
-    void addFine(double amount) { outstandingFine += amount; }
-    void clearFine() { outstandingFine = 0; }
     double getFine() const { return outstandingFine; }
 
     // Print methods for each attribute
@@ -69,7 +106,7 @@ public:
     }
 
     // Getters for borrowing information
-    const std::vector<std::string>& getCurrentlyBorrowedBooks() const { 
+    const std::vector<Id>& getCurrentlyBorrowedBooks() const { 
         return currentlyBorrowedBooks; 
     }
     const std::vector<BorrowRecord>& getBorrowHistory() const { 
@@ -77,13 +114,22 @@ public:
     }
 
     // Update methods
-    void updateFine(double newFine) { outstandingFine = newFine; }
-    void removeBorrowedBook(const std::string& bookId);
-    void clearBorrowHistory() { borrowHistory.clear(); }
+    void removeBorrowedBook(Id bookId);
+    void clearBorrowHistory() {
+        borrowHistory.clear();
+        reindexOpenLoans();
+    }
+    // Remove all but the `keep` most recently returned loans; returns the
+    // removed records in history order
+    std::vector<BorrowRecord> trimHistory(std::size_t keep = RECENT_HISTORY);
 
     // Serialization
     std::string serialize() const;
-    static Account deserialize(const std::string& data);
+    static Account deserialize(const std::string& data);  // throws std::invalid_argument
+    static bool parse(std::string_view data, Account& account, ParseError& error);
+
+    friend class Library;
+    friend class Snapshot;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,341 @@
+// Library operation benchmarks on generated data.
+// Prints one JSON document: per benchmark the op count, p50/p99/max
+// latency, throughput and heap allocations per op, plus the interned
+// string pool size and the process's peak RSS.
+//
+// Usage: ./bench_library [--books N] [--users N] [--history N] [--ops N] [--seed N]
+//                        [--open-loans N] [--overdue-pct P] [--check-allocs]
+// Every other user holds --open-loans open loans (default 2), --overdue-pct
+// of them overdue (default 30) with the fines owed for them, so the fine
+// projection and the debtor index have work to do.
+// --check-allocs exits 1 if any read-path benchmark allocated.
+#include <sys/resource.h>
+#include <stdlib.h>
+#include <cstdlib>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+#include "library.hpp"
+#include "synthetic_data.hpp"
+
+// Heap allocations made by this thread, counted by the replacement
+// operator new below (work handed to other threads is not included)
+namespace {
+thread_local std::size_t threadAllocations = 0;
+
+void* countedAlloc(std::size_t size) {
+    ++threadAllocations;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* countedAlignedAlloc(std::size_t size, std::align_val_t align) {
+    ++threadAllocations;
+    std::size_t alignment = static_cast<std::size_t>(align);
+    if (void* p = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+}
+
+void* operator new(std::size_t size) { return countedAlloc(size); }
+void* operator new[](std::size_t size) { return countedAlloc(size); }
+void* operator new(std::size_t size, std::align_val_t align) { return countedAlignedAlloc(size, align); }
+void* operator new[](std::size_t size, std::align_val_t align) { return countedAlignedAlloc(size, align); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+struct Result {
+    std::string name;
+    std::vector<double> latenciesNs;
+    double seconds = 0.0;
+    std::size_t allocations = 0;
+};
+
+// Time op(i) for i in [0, ops) one call at a time
+template <typename Op>
+Result measure(const std::string& name, std::size_t ops, Op op) {
+    Result result;
+    result.name = name;
+    result.latenciesNs.reserve(ops);
+    std::size_t allocationsBefore = threadAllocations;
+    auto begin = Clock::now();
+    for (std::size_t i = 0; i < ops; ++i) {
+        auto start = Clock::now();
+        op(i);
+        result.latenciesNs.push_back(
+            std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+    }
+    result.seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+    result.allocations = threadAllocations - allocationsBefore;
+    return result;
+}
+
+// Time constructing and initializing a Library; the checkpoint its
+// destructor runs is left out
+template <typename Prepare>
+Result measureLoad(const std::string& name, std::size_t runs, const std::string& dataDir,
+                   Prepare prepare) {
+    Result result;
+    result.name = name;
+    for (std::size_t i = 0; i < runs; ++i) {
+        prepare();
+        std::size_t allocationsBefore = threadAllocations;
+        auto start = Clock::now();
+        auto library = std::make_unique<Library>(dataDir);
+        library->initialize();
+        std::chrono::duration<double> elapsed = Clock::now() - start;
+        result.allocations += threadAllocations - allocationsBefore;
+        result.latenciesNs.push_back(elapsed.count() * 1e9);
+        result.seconds += elapsed.count();
+    }
+    return result;
+}
+
+double percentile(std::vector<double> sorted, double p) {
+    if (sorted.empty()) return 0.0;
+    std::sort(sorted.begin(), sorted.end());
+    return sorted[static_cast<std::size_t>(p * (sorted.size() - 1))];
+}
+
+long peakRssKb() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;  // kilobytes on Linux
+}
+
+void printJson(std::ostream& out, const SyntheticData::Config& config, std::size_t ops,
+               const std::vector<Result>& results) {
+    out << "{\n  \"config\": {\"books\": " << config.books << ", \"users\": " << config.users
+        << ", \"history\": " << config.history << ", \"ops\": " << ops
+        << ", \"seed\": " << config.seed << ", \"open_loans\": " << config.openLoans
+        << ", \"overdue_pct\": " << config.overduePct << "},\n  \"benchmarks\": [\n";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        double maxNs = r.latenciesNs.empty() ? 0.0
+                                             : *std::max_element(r.latenciesNs.begin(), r.latenciesNs.end());
+        out << "    {\"name\": \"" << r.name << "\", \"ops\": " << r.latenciesNs.size()
+            << ", \"p50_ns\": " << static_cast<long long>(percentile(r.latenciesNs, 0.50))
+            << ", \"p99_ns\": " << static_cast<long long>(percentile(r.latenciesNs, 0.99))
+            << ", \"max_ns\": " << static_cast<long long>(maxNs)
+            << ", \"ops_per_sec\": " << std::fixed << std::setprecision(2)
+            << (r.seconds > 0 ? r.latenciesNs.size() / r.seconds : 0.0)
+            << ", \"allocs_per_op\": "
+            << (r.latenciesNs.empty() ? 0.0 : static_cast<double>(r.allocations) / r.latenciesNs.size())
+            << "}"
+            << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ],\n  \"string_pool\": {\"strings\": " << StringPool::shared().size()
+        << ", \"bytes\": " << StringPool::shared().bytes() << "},\n  \"peak_rss_kb\": "
+        << peakRssKb() << "\n}\n";
+}
+}
+
+int main(int argc, char* argv[]) {
+    SyntheticData::Config config;
+    config.openLoans = 2;
+    config.overduePct = 30;
+    config.now = Utils::getCurrentTime();  // the fines are projected against it
+    std::size_t ops = 100000;
+    bool checkAllocs = false;
+    for (int i = 1; i < argc; i += 2) {
+        std::string flag = argv[i];
+        if (flag == "--check-allocs") {
+            checkAllocs = true;
+            --i;
+            continue;
+        }
+        if (i + 1 == argc) {
+            std::cerr << "Missing value for " << flag << "\n";
+            return 1;
+        }
+        unsigned long value = std::stoul(argv[i + 1]);
+        if (flag == "--books") config.books = value;
+        else if (flag == "--users") config.users = value;
+        else if (flag == "--history") config.history = static_cast<int>(value);
+        else if (flag == "--ops") ops = value;
+        else if (flag == "--seed") config.seed = static_cast<unsigned>(value);
+        else if (flag == "--open-loans") config.openLoans = static_cast<int>(value);
+        else if (flag == "--overdue-pct") config.overduePct = static_cast<int>(value);
+        else {
+            std::cerr << "Unknown option " << flag << "\n";
+            return 1;
+        }
+    }
+    const std::size_t loadRuns = 5;
+    const std::size_t mutationOps = std::max<std::size_t>(1, ops / 50);  // each one waits for a sync
+
+    char dirTemplate[] = "/tmp/library-bench-XXXXXX";
+    if (!mkdtemp(dirTemplate)) {
+        std::cerr << "Cannot create a scratch directory\n";
+        return 1;
+    }
+    const std::string dataDir = dirTemplate;
+    SyntheticData::write(dataDir, config);
+
+    // The library narrates everything on std::cout; keep the JSON clean
+    std::ofstream devNull("/dev/null");
+    std::streambuf* stdoutBuf = std::cout.rdbuf(devNull.rdbuf());
+    std::vector<Result> results;
+
+    // Cold loads: from the text files, then from the snapshot they produce
+    results.push_back(measureLoad("loadData_text", loadRuns, dataDir, [&]() {
+        std::filesystem::remove(dataDir + "/snapshot.bin");
+    }));
+    {
+        Library library(dataDir);
+        library.initialize();
+        library.checkpoint();  // writes the snapshot
+    }
+    results.push_back(measureLoad("loadData_snapshot", loadRuns, dataDir, []() {}));
+
+    {
+        Library library(dataDir);
+        library.initialize();
+        std::mt19937 rng(config.seed);
+        auto randomBook = [&]() { return SyntheticData::bookId(rng() % config.books); };
+        auto randomUser = [&]() { return SyntheticData::userId(rng() % config.users); };
+        const std::vector<std::string> queries = {"Shadow", "the River", "Gold", "Sto", "Author 12", "ou"};
+
+        results.push_back(measure("saveData", loadRuns, [&](std::size_t) {
+            library.checkpoint();
+        }));
+        results.push_back(measure("findBook", ops, [&](std::size_t) {
+            library.findBook(randomBook());
+        }));
+        results.push_back(measure("findUser", ops, [&](std::size_t) {
+            library.findUser(randomUser());
+        }));
+        std::vector<User*> someUsers;
+        for (std::size_t i = 0; i < std::min<std::size_t>(config.users, 1000); ++i) {
+            someUsers.push_back(library.findUser(SyntheticData::userId(i)));
+        }
+        results.push_back(measure("authenticate", ops, [&](std::size_t i) {
+            const User* user = someUsers[i % someUsers.size()];
+            library.authenticate(user->getEmail(), user->getPassword());
+        }));
+        // Into one reused vector, sized by a first pass over the queries
+        std::vector<Book*> found;
+        for (const auto& query : queries) library.searchBooks(query, found);
+        results.push_back(measure("searchBooks", std::max<std::size_t>(1, ops / 100), [&](std::size_t i) {
+            library.searchBooks(queries[i % queries.size()], found);
+        }));
+        // The same queries as a linear scan, the baseline the index must beat
+        results.push_back(measure("searchBooks_scan", std::max<std::size_t>(1, ops / 100), [&](std::size_t i) {
+            const std::string& query = queries[i % queries.size()];
+            library.filterBooks([&](const BookStore::View& view) {
+                const Book* book = view.book();
+                return book->getTitle().find(query) != std::string::npos ||
+                       book->getAuthor().find(query) != std::string::npos ||
+                       book->getIsbn().find(query) != std::string::npos;
+            });
+        }));
+
+        // Whole-catalogue column scans
+        const std::size_t scans = std::max<std::size_t>(1, ops / 1000);
+        results.push_back(measure("countBooks", scans, [&](std::size_t) {
+            library.countBooks(BookStatus::AVAILABLE);
+        }));
+        results.push_back(measure("filterBooks", scans, [&](std::size_t) {
+            library.filterBooks([](const BookStore::View& book) { return book.year() < 1850; });
+        }));
+
+        // Fines over the generated loan histories
+        std::vector<std::pair<Id, Id>> loans;
+        for (std::size_t i = 0; i < std::min<std::size_t>(config.users, 1000); ++i) {
+            User* user = library.findUser(SyntheticData::userId(i));
+            for (const auto& record : user->getAccount().getBorrowHistory()) {
+                loans.emplace_back(user->getId(), record.bookId);
+            }
+        }
+        if (!loans.empty()) {
+            results.push_back(measure("calculateFine", ops, [&](std::size_t i) {
+                const auto& loan = loans[i % loans.size()];
+                library.calculateFine(loan.first, loan.second);
+            }));
+        }
+
+        // Projected fines over every open loan, overdue ones included
+        results.push_back(measure("projectFines", scans, [&](std::size_t) {
+            library.projectFines(Utils::getCurrentTime());
+        }));
+
+        // Fines ledger, seeded with the fines of the overdue loans: no
+        // account is visited. Without overdue loans (--overdue-pct 0) the
+        // users that hold loans get a fine here, so the ordered index is
+        // not measured empty.
+        if (library.getDebtorCount() == 0) {
+            for (std::size_t i = 0; i < config.users; ++i) {
+                if (SyntheticData::holdsLoans(i)) {
+                    library.addFine(SyntheticData::userId(i), 1.0 + rng() % 500);
+                }
+            }
+        }
+        results.push_back(measure("topDebtors", ops, [&](std::size_t) {
+            library.getTopDebtors(50);
+        }));
+
+        // Borrows turned down in validation (the copy is already out)
+        Id takenBook = randomBook();
+        library.borrowBook(SyntheticData::userId(0), takenBook);
+        results.push_back(measure("borrowBook_rejected", ops, [&](std::size_t) {
+            library.borrowBook(randomUser(), takenBook);
+        }));
+        library.returnBook(SyntheticData::userId(0), takenBook);
+
+        // Borrow then return the same copy, each timed on its own; patrons
+        // without generated loans (or fines) and books not out on them
+        std::vector<Id> borrowed(mutationOps);
+        std::vector<Id> borrowers(mutationOps);
+        std::size_t freeUsers = (config.users + 1) / 2;  // the even indexes
+        std::size_t freeBooks = std::max<std::size_t>(1, config.books - SyntheticData::loanedBooks(config));
+        results.push_back(measure("borrowBook", mutationOps, [&](std::size_t i) {
+            borrowers[i] = SyntheticData::userId(rng() % freeUsers * 2);
+            borrowed[i] = SyntheticData::bookId(rng() % freeBooks);
+            library.borrowBook(borrowers[i], borrowed[i]);
+        }));
+        results.push_back(measure("returnBook", mutationOps, [&](std::size_t i) {
+            library.returnBook(borrowers[i], borrowed[i]);
+        }));
+    }
+
+    std::cout.rdbuf(stdoutBuf);
+    printJson(std::cout, config, ops, results);
+
+    std::error_code ignored;
+    std::filesystem::remove_all(dataDir, ignored);
+
+    // The read path must not touch the heap
+    int status = 0;
+    if (checkAllocs) {
+        const std::vector<std::string> readPath = {"findBook", "findUser", "authenticate", "searchBooks",
+                                                   "countBooks", "calculateFine", "borrowBook_rejected"};
+        for (const Result& r : results) {
+            if (r.allocations > 0 &&
+                std::find(readPath.begin(), readPath.end(), r.name) != readPath.end()) {
+                std::cerr << "FAIL: " << r.name << " made " << r.allocations << " allocations in "
+                          << r.latenciesNs.size() << " ops\n";
+                status = 1;
+            }
+        }
+    }
+    return status;
+}
@@ -0,0 +1,139 @@
+// Record parser throughput: the previous stringstream/stoi parser against
+// the string_view/from_chars parser, on synthetic books.txt/users.txt lines.
+//
+// Usage: ./bench_parse [records]
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "book.hpp"
+#include "user.hpp"
+
+namespace {
+
+std::vector<std::string> makeBookLines(std::size_t count) {
+    std::vector<std::string> lines;
+    lines.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        std::ostringstream ss;
+        ss << "B" << i << "|Title number " << i << " of the synthetic catalogue|Author "
+           << (i % 5000) << "|Publisher " << (i % 50) << "|" << (1800 + i % 225)
+           << "|978-" << (1000000000 + i) << "|" << (i % 3);
+        lines.push_back(ss.str());
+    }
+    return lines;
+}
+
+std::vector<std::string> makeUserLines(std::size_t count, int history) {
+    std::vector<std::string> lines;
+    lines.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        std::ostringstream ss;
+        ss << (i % 2) << "|U" << i << "|Patron " << i << "|patron" << i << "@example.com|pw" << i
+           << "|" << (i % 7) * 10 << ";1;B" << i << ",;" << history << ";";
+        for (int h = 0; h < history; ++h) {
+            ss << "B" << (i + h) << "," << (1700000000 + h * 86400) << ","
+               << (h + 1 == history ? 0 : 1700000000 + h * 86400 + 3600) << ";";
+        }
+        lines.push_back(ss.str());
+    }
+    return lines;
+}
+
+// The parsers as they were before the string_view rewrite
+std::size_t legacyParseBook(const std::string& data) {
+    std::stringstream ss(data);
+    std::string id, title, author, publisher, isbn, statusStr, yearStr;
+    std::getline(ss, id, '|');
+    std::getline(ss, title, '|');
+    std::getline(ss, author, '|');
+    std::getline(ss, publisher, '|');
+    std::getline(ss, yearStr, '|');
+    std::getline(ss, isbn, '|');
+    std::getline(ss, statusStr, '|');
+    Book book(title, author, publisher, std::stoi(yearStr), isbn);
+    return book.getTitle().size() + std::stoi(statusStr);
+}
+
+std::size_t legacyParseUser(const std::string& data) {
+    std::stringstream ss(data);
+    std::string roleStr, id, name, email, password, accountData;
+    std::getline(ss, roleStr, '|');
+    std::getline(ss, id, '|');
+    std::getline(ss, name, '|');
+    std::getline(ss, email, '|');
+    std::getline(ss, password, '|');
+    std::getline(ss, accountData);
+    std::unique_ptr<User> user(User::create(static_cast<UserRole>(std::stoi(roleStr)),
+                                            name, email, password));
+
+    std::stringstream as(accountData);
+    std::string segment;
+    std::vector<std::string> current;
+    std::vector<BorrowRecord> history;
+    std::getline(as, segment, ';');
+    double fine = std::stod(segment);
+    std::getline(as, segment, ';');
+    int currentSize = std::stoi(segment);
+    std::getline(as, segment, ';');
+    if (currentSize > 0) {
+        std::stringstream bookSS(segment);
+        std::string bookId;
+        while (std::getline(bookSS, bookId, ',')) {
+            if (!bookId.empty()) current.push_back(bookId);
+        }
+    }
+    std::getline(as, segment, ';');
+    int historySize = std::stoi(segment);
+    for (int i = 0; i < historySize; ++i) {
+        std::getline(as, segment, ';');
+        std::stringstream recordSS(segment);
+        std::string bookId, borrowDate, returnDate;
+        std::getline(recordSS, bookId, ',');
+        std::getline(recordSS, borrowDate, ',');
+        std::getline(recordSS, returnDate, ',');
+        history.push_back(BorrowRecord{Id::fromString(bookId),
+                                       static_cast<std::time_t>(std::stoll(borrowDate)),
+                                       static_cast<std::time_t>(std::stoll(returnDate))});
+    }
+    return current.size() + history.size() + static_cast<std::size_t>(fine);
+}
+
+template <typename Fn>
+double recordsPerSecond(const std::vector<std::string>& lines, Fn parse) {
+    std::size_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& line : lines) {
+        sink += parse(line);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    if (sink == 0) std::cerr << "";  // keep the work observable
+    return lines.size() / elapsed.count();
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    std::size_t records = argc > 1 ? std::stoul(argv[1]) : 200000;
+    auto bookLines = makeBookLines(records);
+    auto userLines = makeUserLines(records / 4, 20);
+
+    ParseError error;
+    double oldBooks = recordsPerSecond(bookLines, legacyParseBook);
+    double newBooks = recordsPerSecond(bookLines, [&](const std::string& line) {
+        return Book::parse(line, error)->getTitle().size();
+    });
+    double oldUsers = recordsPerSecond(userLines, legacyParseUser);
+    double newUsers = recordsPerSecond(userLines, [&](const std::string& line) {
+        return User::parse(line, error)->getAccount().getBorrowHistory().size();
+    });
+
+    std::cout << "{\"benchmark\":\"parse\",\"book_records\":" << bookLines.size()
+              << ",\"user_records\":" << userLines.size()
+              << ",\"books_per_sec\":{\"stringstream\":" << static_cast<long long>(oldBooks)
+              << ",\"string_view\":" << static_cast<long long>(newBooks) << "}"
+              << ",\"users_per_sec\":{\"stringstream\":" << static_cast<long long>(oldUsers)
+              << ",\"string_view\":" << static_cast<long long>(newUsers) << "}}\n";
+    return 0;
+}
@@ -1,40 +1,132 @@
 #include "book.hpp"
+#include "library.hpp"
+#include "status_bitmap.hpp"
 #include "utils.hpp"
 #include <sstream>
+#include <stdexcept>
 
-Book::Book(const std::string& title, const std::string& author, 
-           const std::string& publisher, int year, const std::string& isbn)
-    : id(Utils::generateUniqueId())
-    , title(title)
-    , author(author)
-    , publisher(publisher)
+// Racing changes may mark out of order; whoever marked a value that is no
+// longer current marks again, so the last mark is always the live status
+void AtomicBookStatus::publish() {
+    BookStatus current;
+    do {
+        current = load();
+        bitmap->mark(row, current);
+    } while (load() != current);
+}
+
+void AtomicBookStatus::attach(std::atomic<BookStatus>* slot, StatusBitmap* rows, std::size_t index) {
+    slot->store(load(), std::memory_order_relaxed);
+    value = slot;
+    bitmap = rows;
+    row = index;
+    publish();
+}
+
+Book::Book(std::string title, std::string_view author,
+           std::string_view publisher, int year, std::string isbn)
+    : Book(Utils::generateUniqueId(), std::move(title), author, publisher,
+           year, std::move(isbn), BookStatus::AVAILABLE) {}
+
+Book::Book(Id id, std::string title, std::string_view author,
+           std::string_view publisher, int year, std::string isbn,
+           BookStatus status)
+    : id(id)
+    , title(std::move(title))
+    , author(StringPool::shared().intern(author))
+    , publisher(StringPool::shared().intern(publisher))
     , year(year)
-    , isbn(isbn)
-    , status(BookStatus::AVAILABLE) {}
+    , isbn(std::move(isbn))
+    , status(status)
+    , owner(nullptr) {}
+
+void Book::applyUpdate(bool searchable, const std::function<void()>& change) {
+    if (owner) {
+        owner->updateBook(this, searchable, change);
+    } else {
+        change();
+    }
+}
+
+void Book::updateTitle(const std::string& newTitle) {
+    applyUpdate(true, [&] { title = newTitle; });
+}
+
+void Book::updateAuthor(const std::string& newAuthor) {
+    applyUpdate(true, [&] { author = StringPool::shared().intern(newAuthor); });
+}
+
+void Book::updatePublisher(const std::string& newPublisher) {
+    applyUpdate(false, [&] { publisher = StringPool::shared().intern(newPublisher); });
+}
+
+void Book::updateYear(int newYear) {
+    applyUpdate(false, [&] { year = newYear; });
+}
+
+void Book::updateIsbn(const std::string& newIsbn) {
+    applyUpdate(true, [&] { isbn = newIsbn; });
+}
 
 std::string Book::serialize() const {
     std::stringstream ss;
-    ss << id << "|" << title << "|" << author << "|" 
-       << publisher << "|" << year << "|" << isbn << "|" 
-       << static_cast<int>(status);
+    ss << id << "|" << title << "|" << getAuthor() << "|" 
+       << getPublisher() << "|" << year << "|" << isbn << "|" 
+       << static_cast<int>(getStatus());
     return ss.str();
 }
 
 Book Book::deserialize(const std::string& data) {
-    std::stringstream ss(data);
-    std::string id, title, author, publisher, isbn, statusStr, yearStr;
-
-    std::getline(ss, id, '|');
-    std::getline(ss, title, '|');
-    std::getline(ss, author, '|');
-    std::getline(ss, publisher, '|');
-    std::getline(ss, yearStr, '|');
-    std::getline(ss, isbn, '|');
-    std::getline(ss, statusStr, '|');
-
-    Book book(title, author, publisher, std::stoi(yearStr), isbn);
-    book.id = id;
-    book.status = static_cast<BookStatus>(std::stoi(statusStr));
-
-    return book;
-}
\ No newline at end of file
+    ParseError error;
+    std::unique_ptr<Book> book = parse(data, error);
+    if (!book) {
+        throw std::invalid_argument("Book::deserialize: " + error.describe());
+    }
+    return std::move(*book);
+}
+
+std::unique_ptr<Book> Book::parse(std::string_view data, ParseError& error) {
+    if (!data.empty() && data.back() == '\r') data.remove_suffix(1);
+
+    FieldReader reader(data);
+    std::string_view id, title, author, publisher, yearStr, isbn, statusStr;
+    int parsedYear = 0;
+    int parsedStatus = 0;
+
+    Id parsedId;
+    if (!reader.next('|', id) || !Id::parse(id, parsedId)) {
+        parseFailure(error, "id", "expected 1-12 characters 0-9/A-Z");
+        return nullptr;
+    }
+    if (!reader.next('|', title)) {
+        parseFailure(error, "title", "missing");
+        return nullptr;
+    }
+    if (!reader.next('|', author)) {
+        parseFailure(error, "author", "missing");
+        return nullptr;
+    }
+    if (!reader.next('|', publisher)) {
+        parseFailure(error, "publisher", "missing");
+        return nullptr;
+    }
+    if (!reader.next('|', yearStr) || !parseNumber(yearStr, parsedYear)) {
+        parseFailure(error, "year", "expected an integer");
+        return nullptr;
+    }
+    if (!reader.next('|', isbn)) {
+        parseFailure(error, "isbn", "missing");
+        return nullptr;
+    }
+    if (!reader.next('|', statusStr) || !parseNumber(statusStr, parsedStatus) ||
+        parsedStatus < 0 || parsedStatus > static_cast<int>(BookStatus::RESERVED)) {
+        parseFailure(error, "status", "expected 0, 1 or 2");
+        return nullptr;
+    }
+
+    // The only allocations are the strings the Book keeps; author and
+    // publisher are interned straight from the line
+    return std::make_unique<Book>(parsedId, std::string(title), author,
+                                  publisher, parsedYear, std::string(isbn),
+                                  static_cast<BookStatus>(parsedStatus));
+}
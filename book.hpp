@@ -1,61 +1,137 @@
 #ifndef BOOK_HPP
 #define BOOK_HPP
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <string>
+#include <string_view>
+#include <memory>
 #include <iostream>
+#include "id.hpp"
+#include "record_parser.hpp"
+#include "string_pool.hpp"
+
+class Library;
+class StatusBitmap;
 
 // Encapsulation: Status as enum class for type safety
-enum class BookStatus {
+enum class BookStatus : std::uint8_t {
     AVAILABLE,
     BORROWED,
     RESERVED
 };
 
+// A book's status. While the book sits in a BookStore the value lives in
+// the store's status column (attach()), otherwise in the object itself;
+// attached, every change is also marked in the store's StatusBitmap.
+// std::atomic isn't copyable; copying copies the current status into a
+// detached object.
+class AtomicBookStatus {
+private:
+    std::atomic<BookStatus> own;
+    std::atomic<BookStatus>* value;
+    StatusBitmap* bitmap;  // while attached
+    std::size_t row;
+
+    // Mark the current value in the bitmap
+    void publish();
+
+public:
+    AtomicBookStatus(BookStatus status) : own(status), value(&own), bitmap(nullptr), row(0) {}
+    AtomicBookStatus(const AtomicBookStatus& other)
+        : own(other.load()), value(&own), bitmap(nullptr), row(0) {}
+    AtomicBookStatus& operator=(const AtomicBookStatus& other) {
+        store(other.load());
+        return *this;
+    }
+
+    BookStatus load() const { return value->load(std::memory_order_acquire); }
+    void store(BookStatus status) {
+        value->store(status, std::memory_order_release);
+        if (bitmap) publish();
+    }
+    bool compareExchange(BookStatus expected, BookStatus desired) {
+        if (!value->compare_exchange_strong(expected, desired, std::memory_order_acq_rel)) {
+            return false;
+        }
+        if (bitmap) publish();
+        return true;
+    }
+
+    // Move the value into slot (row `row` of bitmap) / back into the
+    // object. Nothing may change the status meanwhile (BookStore callers
+    // hold the exclusive lock); the store unmarks rows it drops.
+    void attach(std::atomic<BookStatus>* slot, StatusBitmap* rows, std::size_t index);
+    void detach() {
+        own.store(load(), std::memory_order_relaxed);
+        value = &own;
+        bitmap = nullptr;
+    }
+};
+
 class Book {
 private:
     // Encapsulation: Private data members
-    std::string id;
+    Id id;
     std::string title;
-    std::string author;
-    std::string publisher;
+    StringPool::Handle author;     // interned: few distinct authors and
+    StringPool::Handle publisher;  // publishers across a catalogue
     int year;
     std::string isbn;
-    BookStatus status;
+    AtomicBookStatus status;
+    Library* owner;  // Library whose index and journal must follow our updates
+
+    // Run change under the owning Library's catalogue lock (if any)
+    void applyUpdate(bool searchable, const std::function<void()>& change);
 
 public:
-    // Constructor
-    Book(const std::string& title, const std::string& author, 
-         const std::string& publisher, int year, const std::string& isbn);
+    // Constructor; a new book gets a fresh ID
+    Book(std::string title, std::string_view author,
+         std::string_view publisher, int year, std::string isbn);
+    // A stored book, keeping its ID and status
+    Book(Id id, std::string title, std::string_view author,
+         std::string_view publisher, int year, std::string isbn,
+         BookStatus status);
 
     // Encapsulation: Getters
-    std::string getId() const { return id; }
-    std::string getTitle() const { return title; }
-    std::string getAuthor() const { return author; }
-    std::string getPublisher() const { return publisher; }
+    Id getId() const { return id; }
+    const std::string& getTitle() const { return title; }
+    std::string_view getAuthor() const { return author.view(); }
+    std::string_view getPublisher() const { return publisher.view(); }
+    // Same author/publisher as another book; a pointer compare
+    bool sameAuthor(const Book& other) const { return author == other.author; }
+    bool samePublisher(const Book& other) const { return publisher == other.publisher; }
     int getYear() const { return year; }
-    std::string getIsbn() const { return isbn; }
-    BookStatus getStatus() const { return status; }
+    const std::string& getIsbn() const { return isbn; }
+    BookStatus getStatus() const { return status.load(); }
 
     // Print methods for each attribute
     void printId() const { std::cout << "Book ID: " << id << std::endl; }
     void printTitle() const { std::cout << "Title: " << title << std::endl; }
-    void printAuthor() const { std::cout << "Author: " << author << std::endl; }
-    void printPublisher() const { std::cout << "Publisher: " << publisher << std::endl; }
+    void printAuthor() const { std::cout << "Author: " << getAuthor() << std::endl; }
+    void printPublisher() const { std::cout << "Publisher: " << getPublisher() << std::endl; }
     void printYear() const { std::cout << "Year: " << year << std::endl; }
     void printIsbn() const { std::cout << "ISBN: " << isbn << std::endl; }
     void printStatus() const { 
+        BookStatus current = getStatus();
         std::cout << "Status: " << 
-            (status == BookStatus::AVAILABLE ? "Available" : 
-             status == BookStatus::BORROWED ? "Borrowed" : "Reserved") << std::endl; 
+            (current == BookStatus::AVAILABLE ? "Available" : 
+             current == BookStatus::BORROWED ? "Borrowed" : "Reserved") << std::endl; 
     }
 
-    // Update methods for attributes
-    void updateTitle(const std::string& newTitle) { title = newTitle; }
-    void updateAuthor(const std::string& newAuthor) { author = newAuthor; }
-    void updatePublisher(const std::string& newPublisher) { publisher = newPublisher; }
-    void updateYear(int newYear) { year = newYear; }
-    void updateIsbn(const std::string& newIsbn) { isbn = newIsbn; }
-    void setStatus(BookStatus newStatus) { status = newStatus; }
+    // Update methods for attributes (searchable fields re-index themselves)
+    void updateTitle(const std::string& newTitle);
+    void updateAuthor(const std::string& newAuthor);
+    void updatePublisher(const std::string& newPublisher);
+    void updateYear(int newYear);
+    void updateIsbn(const std::string& newIsbn);
+    void setStatus(BookStatus newStatus) { status.store(newStatus); }
+    // Atomic compare-and-swap; false if the status was not `expected`
+    bool tryChangeStatus(BookStatus expected, BookStatus desired) {
+        return status.compareExchange(expected, desired);
+    }
 
     // Print all details
     void printDetails() const {
@@ -70,7 +146,12 @@ public:
 
     // Serialization
     std::string serialize() const;
-    static Book deserialize(const std::string& data);
+    static Book deserialize(const std::string& data);  // throws std::invalid_argument
+    static std::unique_ptr<Book> parse(std::string_view data, ParseError& error);
+
+    friend class Library; // Allow Library to attach itself as owner
+    friend class BookStore;
+    friend class Snapshot;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,105 @@
+#include "book_store.hpp"
+#include <algorithm>
+#include <limits>
+
+namespace {
+std::int16_t toYearColumn(int year) {
+    return static_cast<std::int16_t>(std::clamp<int>(year, std::numeric_limits<std::int16_t>::min(),
+                                                     std::numeric_limits<std::int16_t>::max()));
+}
+}
+
+BookStore::BookStore() {}
+
+void BookStore::reserve(std::size_t rows) {
+    books.reserve(rows);
+    ids.reserve(rows);
+    years.reserve(rows);
+    index.reserve(rows);
+}
+
+void BookStore::clear() {
+    books.clear();
+    ids.clear();
+    years.clear();
+    statusChunks.clear();
+    statusBits.clear();
+    index.clear();
+}
+
+bool BookStore::insert(std::unique_ptr<Book> book) {
+    if (!book || !index.emplace(book->getId(), books.size()).second) {
+        return false;
+    }
+    Row row = books.size();
+    if (row % STATUS_CHUNK == 0 && row / STATUS_CHUNK == statusChunks.size()) {
+        statusChunks.emplace_back(new StatusChunk());
+    }
+    statusBits.resize(row + 1);
+    book->status.attach(&status(row), &statusBits, row);
+    ids.push_back(book->getId());
+    years.push_back(toYearColumn(book->getYear()));
+    books.push_back(std::move(book));
+    return true;
+}
+
+std::unique_ptr<Book> BookStore::erase(Id id) {
+    auto it = index.find(id);
+    if (it == index.end()) return nullptr;
+
+    Row row = it->second;
+    Row last = books.size() - 1;
+    index.erase(it);
+
+    std::unique_ptr<Book> removed = std::move(books[row]);
+    removed->status.detach();
+    if (row != last) {
+        books[row] = std::move(books[last]);
+        books[row]->status.attach(&status(row), &statusBits, row);
+        ids[row] = ids[last];
+        years[row] = years[last];
+        index[ids[row]] = row;
+    }
+    statusBits.unmark(last);
+    statusBits.resize(last);
+    books.pop_back();
+    ids.pop_back();
+    years.pop_back();
+    if (books.size() % STATUS_CHUNK == 0 && statusChunks.size() > books.size() / STATUS_CHUNK) {
+        statusChunks.pop_back();
+    }
+    return removed;
+}
+
+void BookStore::refresh(const Book* book) {
+    auto it = index.find(book->getId());
+    if (it == index.end()) return;
+
+    years[it->second] = toYearColumn(book->getYear());
+}
+
+Book* BookStore::find(Id id) const {
+    auto it = index.find(id);
+    return it != index.end() ? books[it->second].get() : nullptr;
+}
+
+std::vector<Book*> BookStore::withStatus(BookStatus wanted, std::size_t limit) const {
+    std::vector<Book*> result;
+    for (Row row = next(wanted, 0); row < books.size() && result.size() < limit;
+         row = next(wanted, row + 1)) {
+        result.push_back(books[row].get());
+    }
+    return result;
+}
+
+BookStore::Row BookStore::next(BookStatus wanted, Row from) const {
+    Row row = statusBits.next(wanted, from);
+    return row == StatusBitmap::npos ? books.size() : row;
+}
+
+void BookStore::setAllStatuses(BookStatus value) {
+    for (Row row = 0; row < books.size(); ++row) {
+        status(row).store(value, std::memory_order_release);
+    }
+    statusBits.fill(value);
+}
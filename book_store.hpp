@@ -0,0 +1,104 @@
+#ifndef BOOK_STORE_HPP
+#define BOOK_STORE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "book.hpp"
+#include "status_bitmap.hpp"
+
+// The books of a Library, one row each, with the fields that scans and
+// filters touch most kept as columns next to the ID column: status as a
+// dense byte column and year as int16. The Book objects stay the owners of
+// every other field (title and author are read through them, not copied)
+// and the API for single records; a book's status lives in the status
+// column itself (Book points into it), so the CAS on checkout and the
+// scans see one value. Each status change is also marked in a per-status
+// bitmap, which answers counts and "rows with this status" without
+// reading the column at all.
+//
+// Not locked: Library changes rows only under the exclusive catalogue
+// lock, and scans under the shared one. Status slots are atomic.
+class BookStore {
+public:
+    using Row = std::size_t;
+
+    // Read-only handle to one row; valid until the store next changes shape
+    class View {
+    private:
+        const BookStore* store;
+        Row row;
+
+    public:
+        View(const BookStore* store, Row row) : store(store), row(row) {}
+
+        Row index() const { return row; }
+        Id id() const { return store->ids[row]; }
+        std::string_view title() const { return store->books[row]->getTitle(); }
+        std::string_view author() const { return store->books[row]->getAuthor(); }
+        int year() const { return store->years[row]; }
+        BookStatus status() const { return store->status(row).load(std::memory_order_acquire); }
+        Book* book() const { return store->books[row].get(); }
+    };
+
+    BookStore();
+
+    std::size_t size() const { return books.size(); }
+    bool empty() const { return books.empty(); }
+    void reserve(std::size_t rows);
+    void clear();
+
+    // false if the ID is already present
+    bool insert(std::unique_ptr<Book> book);
+    // Swap-and-pop; the last row takes the removed one's place
+    std::unique_ptr<Book> erase(Id id);
+    // Re-read a book's year after it was updated
+    void refresh(const Book* book);
+
+    Book* find(Id id) const;
+    View view(Row row) const { return View(this, row); }
+    Book* book(Row row) const { return books[row].get(); }
+    const std::vector<std::unique_ptr<Book>>& all() const { return books; }
+
+    // Status queries from the bitmaps, in row order
+    std::size_t count(BookStatus status) const { return statusBits.count(status); }
+    std::vector<Book*> withStatus(BookStatus status, std::size_t limit = SIZE_MAX) const;
+    // First row >= from with the status, or size()
+    Row next(BookStatus status, Row from) const;
+    void setAllStatuses(BookStatus status);
+
+    // Column scans, in row order
+    template <typename Predicate>
+    std::vector<Book*> filter(Predicate predicate) const {
+        std::vector<Book*> result;
+        for (Row row = 0; row < books.size(); ++row) {
+            if (predicate(view(row))) result.push_back(books[row].get());
+        }
+        return result;
+    }
+
+private:
+    // Status slots come in fixed chunks so their addresses never change
+    static const std::size_t STATUS_CHUNK = 4096;
+    struct StatusChunk {
+        std::atomic<BookStatus> slots[STATUS_CHUNK];
+    };
+
+    std::vector<std::unique_ptr<Book>> books;
+    std::vector<Id> ids;
+    std::vector<std::int16_t> years;
+    std::vector<std::unique_ptr<StatusChunk>> statusChunks;
+    StatusBitmap statusBits;
+    std::unordered_map<Id, Row> index;
+
+    std::atomic<BookStatus>& status(Row row) const {
+        return statusChunks[row / STATUS_CHUNK]->slots[row % STATUS_CHUNK];
+    }
+};
+
+#endif
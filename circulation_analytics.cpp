@@ -0,0 +1,156 @@
+#include "circulation_analytics.hpp"
+#include "record_parser.hpp"
+#include "transaction_segments.hpp"
+#include "utils.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <string_view>
+
+namespace {
+const std::int64_t SECONDS_PER_DAY = 24 * 60 * 60;
+// Chunks smaller than this are not worth a task of their own
+const std::size_t MIN_CHUNK_BYTES = 1 << 20;
+
+std::int64_t dayOf(long long time) {
+    return time >= 0 ? time / SECONDS_PER_DAY : (time - SECONDS_PER_DAY + 1) / SECONDS_PER_DAY;
+}
+
+void addCounts(std::unordered_map<Id, std::uint64_t>& into,
+               const std::unordered_map<Id, std::uint64_t>& from) {
+    for (const auto& entry : from) into[entry.first] += entry.second;
+}
+}
+
+void CirculationStats::merge(const CirculationStats& other) {
+    lines += other.lines;
+    malformed += other.malformed;
+    bytes += other.bytes;
+    borrows += other.borrows;
+    returns += other.returns;
+    fines += other.fines;
+    timedLoans += other.timedLoans;
+    loanSeconds += other.loanSeconds;
+    addCounts(borrowsByBook, other.borrowsByBook);
+    addCounts(borrowsByUser, other.borrowsByUser);
+    for (const auto& entry : other.byDay) {
+        Day& day = byDay[entry.first];
+        day.borrows += entry.second.borrows;
+        day.returns += entry.second.returns;
+    }
+}
+
+std::vector<std::pair<Id, std::uint64_t>> CirculationStats::top(
+    const std::unordered_map<Id, std::uint64_t>& counts, std::size_t count) {
+    std::vector<std::pair<Id, std::uint64_t>> result(counts.begin(), counts.end());
+    auto largerFirst = [](const std::pair<Id, std::uint64_t>& a,
+                          const std::pair<Id, std::uint64_t>& b) {
+        return a.second != b.second ? a.second > b.second : a.first < b.first;
+    };
+    count = std::min(count, result.size());
+    std::partial_sort(result.begin(), result.begin() + count, result.end(), largerFirst);
+    result.resize(count);
+    return result;
+}
+
+std::vector<std::string> CirculationAnalytics::logFiles(const std::string& dataDir) {
+    std::vector<std::string> paths;
+    for (auto& segment : TransactionSegments::list(dataDir + "/transactions.txt")) {
+        paths.push_back(std::move(segment.path));
+    }
+    return paths;
+}
+
+void CirculationAnalytics::parseChunk(const char* begin, const char* end, std::time_t from,
+                                      std::time_t to, CirculationStats& stats) {
+    LineReader lines(std::string_view(begin, static_cast<std::size_t>(end - begin)));
+    std::string_view line;
+    TransactionRecord record;
+    while (lines.next(line)) {
+        if (!TransactionRecord::parse(line, record)) {
+            // Comments and blank lines are not records
+            if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+            if (line.empty() || line.front() == '#') continue;
+            ++stats.lines;
+            ++stats.malformed;
+            continue;
+        }
+        ++stats.lines;
+
+        if (!record.isReturn()) {
+            if (record.borrowDate < from || record.borrowDate >= to) continue;
+            ++stats.borrows;
+            ++stats.borrowsByBook[record.bookId];
+            ++stats.borrowsByUser[record.userId];
+            ++stats.byDay[dayOf(record.borrowDate)].borrows;
+        } else {
+            if (record.returnDate < from || record.returnDate >= to) continue;
+            ++stats.returns;
+            stats.fines += record.fine;
+            ++stats.byDay[dayOf(record.returnDate)].returns;
+            // Older logs wrote the return time in both date fields
+            if (record.borrowDate > 0 && record.borrowDate < record.returnDate) {
+                ++stats.timedLoans;
+                stats.loanSeconds += static_cast<double>(record.returnDate - record.borrowDate);
+            }
+        }
+    }
+}
+
+bool CirculationAnalytics::analyze(const std::vector<std::string>& paths, CirculationStats& stats,
+                                   std::time_t from, std::time_t to) {
+    for (const std::string& path : paths) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            std::cout << "Error: Could not open " << path << "\n";
+            return false;
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            std::cout << "Error: Could not read " << path << "\n";
+            return false;
+        }
+        std::size_t size = static_cast<std::size_t>(st.st_size);
+        if (size == 0) {
+            ::close(fd);
+            continue;
+        }
+        void* mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapping == MAP_FAILED) {
+            std::cout << "Error: Could not map " << path << "\n";
+            return false;
+        }
+        ::madvise(mapping, size, MADV_SEQUENTIAL);
+        const char* text = static_cast<const char*>(mapping);
+
+        // A couple of chunks per worker so an uneven one does not hold the
+        // rest up; each boundary moves forward to just past a newline
+        std::size_t wanted = std::max<std::size_t>(
+            1, std::min(Utils::workerCount() * 2, size / MIN_CHUNK_BYTES));
+        std::vector<const char*> bounds{text};
+        for (std::size_t i = 1; i < wanted; ++i) {
+            const char* cut = std::max(text + size * i / wanted, bounds.back());
+            const char* newline = static_cast<const char*>(
+                std::memchr(cut, '\n', static_cast<std::size_t>(text + size - cut)));
+            if (!newline) break;
+            bounds.push_back(newline + 1);
+        }
+        bounds.push_back(text + size);
+
+        std::vector<CirculationStats> partials(bounds.size() - 1);
+        Utils::parallelFor(partials.size(), [&](std::size_t i) {
+            parseChunk(bounds[i], bounds[i + 1], from, to, partials[i]);
+        });
+        ::munmap(mapping, size);
+
+        for (const CirculationStats& partial : partials) stats.merge(partial);
+        stats.bytes += size;
+    }
+    return true;
+}
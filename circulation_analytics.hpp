@@ -0,0 +1,65 @@
+#ifndef CIRCULATION_ANALYTICS_HPP
+#define CIRCULATION_ANALYTICS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <limits>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "id.hpp"
+
+// Borrow/return counts aggregated from transaction logs
+struct CirculationStats {
+    struct Day {
+        std::uint64_t borrows = 0;
+        std::uint64_t returns = 0;
+    };
+
+    std::uint64_t lines = 0;      // records read, in or out of the window
+    std::uint64_t malformed = 0;
+    std::uint64_t bytes = 0;
+    std::uint64_t borrows = 0;
+    std::uint64_t returns = 0;
+    double fines = 0.0;
+    std::uint64_t timedLoans = 0;      // returns that carry their borrow date
+    double loanSeconds = 0.0;          // summed over timedLoans
+
+    std::unordered_map<Id, std::uint64_t> borrowsByBook;
+    std::unordered_map<Id, std::uint64_t> borrowsByUser;
+    std::map<std::int64_t, Day> byDay;  // UTC days since the epoch
+
+    void merge(const CirculationStats& other);
+    double averageLoanDays() const {
+        return timedLoans ? loanSeconds / timedLoans / (24 * 60 * 60) : 0.0;
+    }
+    // The `count` largest entries of a counter, largest first
+    static std::vector<std::pair<Id, std::uint64_t>> top(
+        const std::unordered_map<Id, std::uint64_t>& counts, std::size_t count);
+};
+
+// Reads transaction logs (BookID|UserID|BorrowDate|ReturnDate|Fine, a
+// return when ReturnDate is set) straight from a read-only mapping. Each
+// file is cut into chunks at line breaks, the chunks are parsed in
+// parallel into their own CirculationStats without copying a field, and
+// the partial results are merged at the end.
+class CirculationAnalytics {
+public:
+    // The transaction log files of a data directory, oldest first
+    static std::vector<std::string> logFiles(const std::string& dataDir);
+
+    // Aggregate every event with from <= time < to; false if a file could
+    // not be read
+    static bool analyze(const std::vector<std::string>& paths, CirculationStats& stats,
+                        std::time_t from = 0,
+                        std::time_t to = std::numeric_limits<std::time_t>::max());
+
+private:
+    static void parseChunk(const char* begin, const char* end, std::time_t from, std::time_t to,
+                           CirculationStats& stats);
+};
+
+#endif
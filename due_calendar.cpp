@@ -0,0 +1,71 @@
+#include "due_calendar.hpp"
+#include <algorithm>
+#include <limits>
+
+DueCalendar::DueCalendar() : loanCount(0) {}
+
+std::int64_t DueCalendar::dayOf(std::time_t time) {
+    // Floor division, so times before the epoch land in the right day
+    std::int64_t day = time / DAY;
+    return (time % DAY < 0) ? day - 1 : day;
+}
+
+void DueCalendar::add(Id userId, Id bookId, std::time_t dueDate) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (buckets[dayOf(dueDate)].emplace(keyOf(userId, bookId), Loan{userId, bookId, dueDate}).second) {
+        ++loanCount;
+    }
+}
+
+void DueCalendar::remove(Id userId, Id bookId, std::time_t dueDate) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto bucket = buckets.find(dayOf(dueDate));
+    if (bucket == buckets.end()) return;
+    if (bucket->second.erase(keyOf(userId, bookId)) > 0) {
+        --loanCount;
+    }
+    if (bucket->second.empty()) {
+        buckets.erase(bucket);
+    }
+}
+
+void DueCalendar::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    buckets.clear();
+    loanCount = 0;
+}
+
+std::size_t DueCalendar::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return loanCount;
+}
+
+std::vector<DueCalendar::Loan> DueCalendar::dueBetween(std::time_t from, std::time_t to) const {
+    std::vector<Loan> loans;
+    if (from >= to) return loans;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto end = buckets.upper_bound(dayOf(to - 1));
+    for (auto bucket = buckets.lower_bound(dayOf(from)); bucket != end; ++bucket) {
+        for (const auto& entry : bucket->second) {
+            // Only the first and last buckets can hold loans outside the range
+            if (entry.second.dueDate >= from && entry.second.dueDate < to) {
+                loans.push_back(entry.second);
+            }
+        }
+    }
+    std::sort(loans.begin(), loans.end(), [](const Loan& a, const Loan& b) {
+        return a.dueDate != b.dueDate ? a.dueDate < b.dueDate : a.userId < b.userId;
+    });
+    return loans;
+}
+
+std::vector<DueCalendar::Loan> DueCalendar::dueOn(std::time_t day) const {
+    std::time_t start = static_cast<std::time_t>(dayOf(day)) * DAY;
+    return dueBetween(start, start + DAY);
+}
+
+std::vector<DueCalendar::Loan> DueCalendar::overdueBy(int days, std::time_t now) const {
+    return dueBetween(std::numeric_limits<std::time_t>::min() + DAY,
+                      now - static_cast<std::time_t>(days) * DAY + 1);
+}
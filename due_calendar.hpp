@@ -0,0 +1,58 @@
+#ifndef DUE_CALENDAR_HPP
+#define DUE_CALENDAR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "id.hpp"
+
+// Library-wide index of open loans bucketed by due day (UTC days since the
+// epoch). "Due today", "due in the next week" and "overdue by N days" are a
+// walk over the matching day buckets instead of a scan of every account.
+// Internally locked; kept in step with borrow and return by Library.
+class DueCalendar {
+public:
+    struct Loan {
+        Id userId;
+        Id bookId;
+        std::time_t dueDate;
+    };
+
+private:
+    static const std::time_t DAY = 24 * 60 * 60;
+
+    struct LoanKeyHash {
+        std::size_t operator()(const std::pair<Id, Id>& key) const {
+            return std::hash<Id>()(key.first) * 31 + std::hash<Id>()(key.second);
+        }
+    };
+    // due day -> loans due that day, keyed by (userId, bookId)
+    std::map<std::int64_t, std::unordered_map<std::pair<Id, Id>, Loan, LoanKeyHash>> buckets;
+    std::size_t loanCount;
+    mutable std::mutex mutex;
+
+    static std::int64_t dayOf(std::time_t time);
+    static std::pair<Id, Id> keyOf(Id userId, Id bookId) { return {userId, bookId}; }
+
+public:
+    DueCalendar();
+
+    void add(Id userId, Id bookId, std::time_t dueDate);
+    void remove(Id userId, Id bookId, std::time_t dueDate);
+    void clear();
+    std::size_t size() const;
+
+    // Loans with from <= dueDate < to, earliest due first
+    std::vector<Loan> dueBetween(std::time_t from, std::time_t to) const;
+    // Loans due on the calendar day containing `day`
+    std::vector<Loan> dueOn(std::time_t day) const;
+    // Loans due at least `days` whole days before `now`
+    std::vector<Loan> overdueBy(int days, std::time_t now) const;
+};
+
+#endif
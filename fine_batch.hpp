@@ -0,0 +1,51 @@
+#ifndef FINE_BATCH_HPP
+#define FINE_BATCH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <vector>
+#include "id.hpp"
+#include "role_policy.hpp"
+
+// Fines of many open loans at once. Loans are added user by user into
+// flat columns (due date, the role's fine schedule, what accrual already
+// charged), and compute() evaluates them all in one branch-free loop the
+// compiler can vectorize, with the same arithmetic as
+// User::calculateFine on Utils::calculateDaysDifference.
+class FineBatch {
+public:
+    struct UserTotal {
+        Id userId;
+        double storedFine;      // Account::getFine()
+        std::size_t overdueLoans;
+        double projectedFine;   // still to charge if every loan came back now
+    };
+
+    // Starts the user that following addLoan calls belong to
+    void addUser(Id userId, double storedFine);
+    void addLoan(std::time_t dueDate, const RolePolicy& policy, double accruedFine);
+    std::size_t loans() const { return dueDates.size(); }
+
+    void compute(std::time_t now);
+    // One entry per addUser, in order; valid after compute()
+    std::vector<UserTotal> totals() const;
+
+private:
+    // Per user
+    std::vector<Id> userIds;
+    std::vector<double> storedFines;
+    std::vector<std::size_t> firstLoan;
+
+    // Per loan. Times are doubles and day counts int32 so the loop only
+    // needs conversions SSE2 has (time_t values fit a double exactly).
+    std::vector<double> dueDates;
+    std::vector<double> finePerDay;
+    std::vector<std::int32_t> graceDays;
+    std::vector<double> maxFine;         // +infinity for no cap
+    std::vector<double> accrued;
+    std::vector<std::int32_t> daysOverdue;
+    std::vector<double> fines;
+};
+
+#endif
@@ -0,0 +1,63 @@
+#include "fines_ledger.hpp"
+#include <algorithm>
+
+FinesLedger::FinesLedger() : totalOwed(0.0) {}
+
+void FinesLedger::erase(Id userId) {
+    auto it = fines.find(userId);
+    if (it == fines.end()) return;
+    byFine.erase(Entry(it->second, userId));
+    totalOwed -= it->second;
+    fines.erase(it);
+    if (fines.empty()) totalOwed = 0.0;  // drop accumulated rounding
+}
+
+void FinesLedger::set(Id userId, double fine) {
+    std::lock_guard<std::mutex> lock(mutex);
+    erase(userId);
+    if (fine <= 0) return;
+    fines.emplace(userId, fine);
+    byFine.emplace(fine, userId);
+    totalOwed += fine;
+}
+
+void FinesLedger::remove(Id userId) {
+    std::lock_guard<std::mutex> lock(mutex);
+    erase(userId);
+}
+
+void FinesLedger::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    byFine.clear();
+    fines.clear();
+    totalOwed = 0.0;
+}
+
+double FinesLedger::total() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return totalOwed;
+}
+
+std::size_t FinesLedger::debtors() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return fines.size();
+}
+
+std::vector<FinesLedger::Debtor> FinesLedger::top(std::size_t count) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<Debtor> result;
+    result.reserve(std::min(count, byFine.size()));
+    for (auto it = byFine.begin(); it != byFine.end() && result.size() < count; ++it) {
+        result.push_back({it->second, it->first});
+    }
+    return result;
+}
+
+std::vector<FinesLedger::Debtor> FinesLedger::owingMoreThan(double amount) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<Debtor> result;
+    for (auto it = byFine.begin(); it != byFine.end() && it->first > amount; ++it) {
+        result.push_back({it->second, it->first});
+    }
+    return result;
+}
@@ -0,0 +1,56 @@
+#ifndef FINES_LEDGER_HPP
+#define FINES_LEDGER_HPP
+
+#include <cstddef>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "id.hpp"
+
+// Library-wide index of outstanding fines: each debtor's fine, ordered
+// largest first, plus the running total. "Total owed", "top N debtors"
+// and "everyone owing more than X" read the front of the order instead
+// of every account. Internally locked; Library sets a user's entry
+// whenever that user's fine changes.
+class FinesLedger {
+public:
+    struct Debtor {
+        Id userId;
+        double fine;
+    };
+
+private:
+    // Largest fine first; ties by ID so the order is total
+    using Entry = std::pair<double, Id>;
+    struct LargestFirst {
+        bool operator()(const Entry& a, const Entry& b) const {
+            return a.first != b.first ? a.first > b.first : a.second < b.second;
+        }
+    };
+
+    std::set<Entry, LargestFirst> byFine;
+    std::unordered_map<Id, double> fines;  // debtors only
+    double totalOwed;
+    mutable std::mutex mutex;
+
+    void erase(Id userId);
+
+public:
+    FinesLedger();
+
+    // Record userId's current fine; 0 or less drops them from the ledger
+    void set(Id userId, double fine);
+    void remove(Id userId);
+    void clear();
+
+    double total() const;
+    std::size_t debtors() const;
+    // The `count` largest fines, largest first
+    std::vector<Debtor> top(std::size_t count) const;
+    // Every fine above `amount`, largest first
+    std::vector<Debtor> owingMoreThan(double amount) const;
+};
+
+#endif
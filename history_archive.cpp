@@ -0,0 +1,174 @@
+#include "history_archive.hpp"
+#include "record_parser.hpp"
+#include "utils.hpp"
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <sstream>
+#include <tuple>
+
+HistoryArchive::HistoryArchive(const std::string& path)
+    : path(path)
+    , fd(-1)
+    , indexedBytes(0) {}
+
+HistoryArchive::~HistoryArchive() {
+    close();
+}
+
+bool HistoryArchive::open() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (fd >= 0) return true;
+
+    // Read-write so read() can pread through the same descriptor
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        std::cout << "Error: Cannot open history archive " << path << "\n";
+        return false;
+    }
+    // The file may be new; sync() only covers its contents
+    Utils::syncParentDirectory(path);
+    return true;
+}
+
+void HistoryArchive::close() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (fd < 0) return;
+    ::fdatasync(fd);
+    ::close(fd);
+    fd = -1;
+}
+
+// Caller holds the mutex
+bool HistoryArchive::writeAll(const std::string& data) {
+    if (fd < 0) {
+        std::cout << "Error: History archive is not open.\n";
+        return false;
+    }
+    std::size_t written = 0;
+    while (written < data.size()) {
+        ssize_t n = ::write(fd, data.data() + written, data.size() - written);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            std::cout << "Error: Cannot write history archive " << path << "\n";
+            return false;
+        }
+        written += static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+bool HistoryArchive::append(Id userId, const std::vector<BorrowRecord>& records) {
+    if (records.empty()) return true;
+
+    std::ostringstream lines;
+    for (const auto& record : records) {
+        lines << userId << "|" << record.bookId << "|" << record.borrowDate << "|"
+              << record.returnDate << "|" << record.accruedFine << "\n";
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    return writeAll(lines.str());
+}
+
+bool HistoryArchive::forget(Id userId) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return writeAll(userId + "|*\n");
+}
+
+bool HistoryArchive::sync() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return fd < 0 || ::fdatasync(fd) == 0;
+}
+
+// Caller holds the mutex. Index whole lines in [indexedBytes, end); a torn
+// last line waits until a newline completes it.
+void HistoryArchive::indexTo(int readFd, std::uint64_t end) {
+    const std::size_t CHUNK = 1 << 20;
+    std::string buffer;
+    while (indexedBytes < end) {
+        buffer.resize(static_cast<std::size_t>(std::min<std::uint64_t>(CHUNK, end - indexedBytes)));
+        ssize_t n = ::pread(readFd, &buffer[0], buffer.size(), static_cast<off_t>(indexedBytes));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+        std::string_view chunk(buffer.data(), static_cast<std::size_t>(n));
+        std::size_t lastNewline = chunk.rfind('\n');
+        if (lastNewline == std::string_view::npos) {
+            if (chunk.size() < CHUNK) return;  // torn tail
+            indexedBytes += chunk.size();      // damaged: no line this long
+            continue;
+        }
+
+        LineReader reader(chunk.substr(0, lastNewline + 1));
+        std::string_view line;
+        std::uint64_t offset = indexedBytes;
+        while (reader.next(line)) {
+            FieldReader fields(line);
+            std::string_view userField, bookField;
+            Id user;
+            if (fields.next('|', userField) && Id::parse(userField, user) &&
+                fields.next('|', bookField)) {
+                if (bookField == "*") {
+                    lines.erase(user);
+                } else {
+                    lines[user].push_back(Line{offset, static_cast<std::uint32_t>(line.size())});
+                }
+            }
+            offset += line.size() + 1;
+        }
+        indexedBytes += lastNewline + 1;
+    }
+}
+
+std::vector<BorrowRecord> HistoryArchive::read(Id userId) {
+    std::lock_guard<std::mutex> lock(mutex);
+    int readFd = fd >= 0 ? fd : ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (readFd < 0) return {};
+
+    std::vector<BorrowRecord> records;
+    struct stat st;
+    if (::fstat(readFd, &st) == 0) {
+        std::uint64_t size = static_cast<std::uint64_t>(st.st_size);
+        if (size < indexedBytes) {
+            // Replaced underneath us; start over
+            lines.clear();
+            indexedBytes = 0;
+        }
+        indexTo(readFd, size);
+    }
+    auto found = lines.find(userId);
+    if (found != lines.end()) {
+        std::string buffer;
+        for (const Line& entry : found->second) {
+            buffer.resize(entry.length);
+            if (::pread(readFd, &buffer[0], entry.length, static_cast<off_t>(entry.offset)) !=
+                static_cast<ssize_t>(entry.length)) {
+                continue;
+            }
+            FieldReader reader(buffer);
+            std::string_view id, bookId, borrowField, returnField, fineField;
+            Id parsedBookId;
+            long long borrowDate = 0, returnDate = 0;
+            double accruedFine = 0.0;
+            if (!reader.next('|', id) || !reader.next('|', bookId) ||
+                !Id::parse(bookId, parsedBookId) ||
+                !reader.next('|', borrowField) || !parseNumber(borrowField, borrowDate) ||
+                !reader.next('|', returnField) || !parseNumber(returnField, returnDate) ||
+                (reader.next('|', fineField) && !parseNumber(fineField, accruedFine))) {
+                continue;  // torn or damaged line
+            }
+            records.push_back(BorrowRecord{parsedBookId, static_cast<std::time_t>(borrowDate),
+                                           static_cast<std::time_t>(returnDate), accruedFine});
+        }
+    }
+    if (readFd != fd) ::close(readFd);
+
+    auto key = [](const BorrowRecord& r) { return std::tie(r.borrowDate, r.returnDate, r.bookId); };
+    std::stable_sort(records.begin(), records.end(),
+                     [&](const BorrowRecord& a, const BorrowRecord& b) { return key(a) < key(b); });
+    records.erase(std::unique(records.begin(), records.end(),
+                              [&](const BorrowRecord& a, const BorrowRecord& b) { return key(a) == key(b); }),
+                  records.end());
+    return records;
+}
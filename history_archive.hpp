@@ -0,0 +1,55 @@
+#ifndef HISTORY_ARCHIVE_HPP
+#define HISTORY_ARCHIVE_HPP
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "account.hpp"
+
+// Append-only store for closed loans trimmed out of accounts, so resident
+// memory and users.txt only carry open loans and a short recent history.
+// Lines are "userId|bookId|borrowDate|returnDate|accruedFine" (older files
+// lack the fine); "userId|*" drops that user's earlier records (account
+// reset). The file is only read when a full history is asked for: an
+// in-memory index of each user's line offsets is brought up to the end
+// of the file on every read, so a read scans only what was appended since
+// the last one and then reads just that user's lines.
+class HistoryArchive {
+private:
+    struct Line {
+        std::uint64_t offset;
+        std::uint32_t length;
+    };
+
+    std::string path;
+    int fd;
+    std::mutex mutex;
+    std::unordered_map<Id, std::vector<Line>> lines;  // by user, file order
+    std::uint64_t indexedBytes;  // the index covers [0, indexedBytes)
+
+    bool writeAll(const std::string& data);
+    void indexTo(int readFd, std::uint64_t end);  // caller holds the mutex
+
+public:
+    explicit HistoryArchive(const std::string& path);
+    ~HistoryArchive();
+
+    HistoryArchive(const HistoryArchive&) = delete;
+    HistoryArchive& operator=(const HistoryArchive&) = delete;
+
+    bool open();
+    void close();
+
+    bool append(Id userId, const std::vector<BorrowRecord>& records);
+    bool forget(Id userId);
+    // Make everything appended so far durable (before users.txt drops it)
+    bool sync();
+
+    // Archived loans of one user, oldest first. Records appended twice (a
+    // crash between archiving and the next checkpoint) are returned once.
+    std::vector<BorrowRecord> read(Id userId);
+};
+
+#endif
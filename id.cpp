@@ -0,0 +1,107 @@
+#include "id.hpp"
+#include <array>
+#include <atomic>
+#include <ostream>
+#include <thread>
+
+namespace {
+const char DIGITS[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+
+// FIRST[n] is the value of "000...0" (n zeros): the count of all shorter strings
+constexpr std::array<std::uint64_t, Id::MAX_LENGTH + 2> firstValues() {
+    std::array<std::uint64_t, Id::MAX_LENGTH + 2> first{};
+    std::uint64_t power = 1;
+    for (std::size_t n = 1; n < first.size(); ++n) {
+        first[n] = first[n - 1] + power;
+        power *= 36;
+    }
+    return first;
+}
+constexpr auto FIRST = firstValues();
+
+// Generated IDs start at 9 characters
+const std::uint64_t GENERATED_BASE = FIRST[9];
+const std::size_t SHARD_BITS = 4;
+const std::size_t SHARDS = std::size_t(1) << SHARD_BITS;
+
+struct alignas(64) Sequence {
+    std::atomic<std::uint64_t> next{0};
+};
+Sequence sequences[SHARDS];
+
+std::size_t threadShard() {
+    static thread_local std::size_t shard =
+        std::hash<std::thread::id>()(std::this_thread::get_id()) % SHARDS;
+    return shard;
+}
+
+int digitValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'Z') return c - 'A' + 10;
+    return -1;
+}
+}
+
+bool Id::parse(std::string_view text, Id& id) {
+    if (text.empty() || text.size() > MAX_LENGTH) return false;
+    std::uint64_t number = 0;
+    for (char c : text) {
+        int digit = digitValue(c);
+        if (digit < 0) return false;
+        number = number * 36 + static_cast<std::uint64_t>(digit);
+    }
+    id.value = FIRST[text.size()] + number;
+    return true;
+}
+
+Id Id::fromString(std::string_view text) {
+    Id id;
+    parse(text, id);
+    return id;
+}
+
+std::string Id::str() const {
+    char text[MAX_LENGTH];
+    return std::string(text, format(text));
+}
+
+std::size_t Id::format(char* out) const {
+    std::size_t length = 0;
+    while (length < MAX_LENGTH && value >= FIRST[length + 1]) ++length;
+    std::uint64_t number = value - FIRST[length];
+    for (std::size_t i = length; i > 0; --i) {
+        out[i - 1] = DIGITS[number % 36];
+        number /= 36;
+    }
+    return length;
+}
+
+Id Id::generate() {
+    std::size_t shard = threadShard();
+    std::uint64_t sequence = sequences[shard].next.fetch_add(1, std::memory_order_relaxed);
+    return fromRaw(GENERATED_BASE + ((sequence << SHARD_BITS) | shard));
+}
+
+void Id::observe(Id id) {
+    if (id.value < GENERATED_BASE) return;
+    std::uint64_t offset = id.value - GENERATED_BASE;
+    std::atomic<std::uint64_t>& next = sequences[offset & (SHARDS - 1)].next;
+    std::uint64_t wanted = (offset >> SHARD_BITS) + 1;
+    std::uint64_t current = next.load(std::memory_order_relaxed);
+    while (current < wanted &&
+           !next.compare_exchange_weak(current, wanted, std::memory_order_relaxed)) {
+    }
+}
+
+std::ostream& operator<<(std::ostream& out, Id id) {
+    char text[Id::MAX_LENGTH];
+    return out << std::string_view(text, id.format(text));
+}
+
+std::string operator+(const std::string& text, Id id) {
+    return text + id.str();
+}
+
+std::string operator+(Id id, const std::string& text) {
+    return id.str() + text;
+}
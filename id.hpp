@@ -0,0 +1,62 @@
+#ifndef ID_HPP
+#define ID_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+
+// Book and user identifier packed into 64 bits.
+// The text form is 1-12 base36 characters (0-9, A-Z). Every such string
+// maps to its own value (shorter strings first, then base36 order), so IDs
+// read from data files written with string IDs come back out unchanged.
+// Text is only produced and parsed at the I/O and UI boundary; everything
+// else compares and hashes the integer.
+class Id {
+private:
+    std::uint64_t value;
+
+public:
+    static const std::size_t MAX_LENGTH = 12;
+
+    constexpr Id() : value(0) {}  // the empty ID, never given to a record
+    static constexpr Id fromRaw(std::uint64_t raw) { Id id; id.value = raw; return id; }
+    constexpr std::uint64_t raw() const { return value; }
+    constexpr bool isValid() const { return value != 0; }
+
+    // Parse the text form; false (and id unchanged) if it isn't one
+    static bool parse(std::string_view text, Id& id);
+    // Parse, or the empty ID for malformed text (which matches no record)
+    static Id fromString(std::string_view text);
+    std::string str() const;
+    // Write the text form (at most MAX_LENGTH characters, no terminator)
+    // into out without allocating; returns its length
+    std::size_t format(char* out) const;
+
+    // A fresh ID: a per-shard sequence number plus the shard, placed above
+    // every 8-character ID so it can't meet one made by the old random
+    // generator. Shards are per thread, so concurrent callers don't share
+    // a counter.
+    static Id generate();
+    // Advance the sequence past an ID loaded from storage
+    static void observe(Id id);
+
+    constexpr bool operator==(Id other) const { return value == other.value; }
+    constexpr bool operator!=(Id other) const { return value != other.value; }
+    constexpr bool operator<(Id other) const { return value < other.value; }
+};
+
+std::ostream& operator<<(std::ostream& out, Id id);
+std::string operator+(const std::string& text, Id id);
+std::string operator+(Id id, const std::string& text);
+
+namespace std {
+template <>
+struct hash<Id> {
+    std::size_t operator()(Id id) const noexcept { return std::hash<std::uint64_t>()(id.raw()); }
+};
+}
+
+#endif
@@ -0,0 +1,174 @@
+#include "journal.hpp"
+#include "utils.hpp"
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+Journal::Journal(const std::string& path)
+    : path(path)
+    , fd(-1)
+    , appendedSeq(0)
+    , durableSeq(0)
+    , recordCount(0)
+    , failed(false)
+    , stopping(false) {}
+
+Journal::~Journal() {
+    close();
+}
+
+bool Journal::open() {
+    if (fd >= 0) return true;
+
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) {
+        std::cout << "Error: Cannot open journal " << path << "\n";
+        return false;
+    }
+    // A new journal's directory entry must survive a crash like its records
+    Utils::syncParentDirectory(path);
+    stopping = false;
+    writer = std::thread(&Journal::writerLoop, this);
+    return true;
+}
+
+void Journal::close() {
+    if (fd < 0) return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    pendingCv.notify_one();
+    writer.join();
+
+    // waitDurable reads fd under the mutex
+    std::lock_guard<std::mutex> lock(mutex);
+    ::close(fd);
+    fd = -1;
+    durableCv.notify_all();
+}
+
+void Journal::writerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        pendingCv.wait(lock, [this] { return stopping || !pending.empty(); });
+        if (pending.empty()) break;  // stopping and fully drained
+        if (failed) {
+            // Writing past a lost batch would make waiters on it succeed
+            pending.clear();
+            continue;
+        }
+
+        // Everything queued while the previous sync was running goes out
+        // together: one write and one fdatasync for the whole group
+        std::string batch;
+        batch.swap(pending);
+        std::uint64_t batchSeq = appendedSeq;
+        lock.unlock();
+
+        // Committers report the failure; this thread only records it
+        std::string error;
+        std::size_t written = 0;
+        while (written < batch.size()) {
+            ssize_t n = ::write(fd, batch.data() + written, batch.size() - written);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                error = std::string("write failed: ") + std::strerror(errno);
+                break;
+            }
+            written += static_cast<std::size_t>(n);
+        }
+        if (error.empty() && ::fdatasync(fd) != 0) {
+            error = std::string("sync failed: ") + std::strerror(errno);
+        }
+
+        lock.lock();
+        if (error.empty()) {
+            durableSeq = batchSeq;
+        } else if (!failed) {
+            failed = true;
+            failure = error;
+        }
+        durableCv.notify_all();
+    }
+    if (!failed) durableSeq = appendedSeq;
+    durableCv.notify_all();
+}
+
+std::uint64_t Journal::append(const std::string& record) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (fd < 0) return 0;
+    if (failed) return ++appendedSeq;  // never durable
+
+    pending += record;
+    pending += '\n';
+    ++recordCount;
+    pendingCv.notify_one();
+    return ++appendedSeq;
+}
+
+bool Journal::waitDurable(std::uint64_t seq) {
+    std::unique_lock<std::mutex> lock(mutex);
+    durableCv.wait(lock, [this, seq] { return durableSeq >= seq || failed || fd < 0; });
+    return durableSeq >= seq;
+}
+
+bool Journal::commit(const std::string& record) {
+    std::uint64_t seq = append(record);
+    return seq == 0 || waitDurable(seq);
+}
+
+std::string Journal::error() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return failure;
+}
+
+bool Journal::reset() {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (fd < 0) return true;
+
+    // A failed batch is dropped, not retried; the snapshot now covers it
+    durableCv.wait(lock, [this] { return durableSeq >= appendedSeq || failed; });
+    if (::ftruncate(fd, 0) != 0 || ::fsync(fd) != 0) {
+        if (!failed) {
+            failed = true;
+            failure = std::string("reset failed: ") + std::strerror(errno);
+        }
+        return false;
+    }
+    recordCount = 0;
+    if (failed) {
+        // Anything still queued belongs to the failed run; drop it too
+        pending.clear();
+        failed = false;
+        failure.clear();
+    }
+    durableSeq = appendedSeq;
+    durableCv.notify_all();
+    return true;
+}
+
+std::size_t Journal::size() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return recordCount;
+}
+
+std::vector<std::string> Journal::readRecords(const std::string& path) {
+    std::vector<std::string> records;
+    std::string data = Utils::readFromFile(path);
+
+    // A torn final line (crash mid-write) has no newline and is ignored
+    std::size_t start = 0;
+    std::size_t end;
+    while ((end = data.find('\n', start)) != std::string::npos) {
+        if (end > start) {
+            records.push_back(data.substr(start, end - start));
+        }
+        start = end + 1;
+    }
+    return records;
+}
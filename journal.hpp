@@ -0,0 +1,68 @@
+#ifndef JOURNAL_HPP
+#define JOURNAL_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Append-only write-ahead journal with group commit.
+// Records are single text lines. A background writer drains everything
+// appended since its last pass with one write() and one fdatasync(), so
+// callers that commit concurrently share the cost of a single sync.
+class Journal {
+private:
+    std::string path;
+    int fd;
+
+    std::mutex mutex;
+    std::condition_variable pendingCv;   // writer waits for new records
+    std::condition_variable durableCv;   // committers wait for the sync
+    std::string pending;
+    std::uint64_t appendedSeq;
+    std::uint64_t durableSeq;
+    std::size_t recordCount;             // records since the last reset
+    // Set when a write or sync fails: nothing after durableSeq will become
+    // durable until a checkpoint resets the journal
+    bool failed;
+    std::string failure;
+    bool stopping;
+    std::thread writer;
+
+    void writerLoop();
+
+public:
+    explicit Journal(const std::string& path);
+    ~Journal();
+
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    bool open();
+    void close();
+    bool isOpen() const { return fd >= 0; }
+
+    // Queue a record; returns its sequence number (0 if the journal is
+    // closed). After a failure records are not queued, and waiting on the
+    // returned number fails.
+    std::uint64_t append(const std::string& record);
+    // Block until the record with the given sequence number is on disk;
+    // false if it never will be (see error())
+    bool waitDurable(std::uint64_t seq);
+    // append() + waitDurable()
+    bool commit(const std::string& record);
+    // Why the journal failed, empty if it has not
+    std::string error();
+
+    // Drop all records once they are folded into a snapshot; clears a
+    // failure once the empty journal is synced
+    bool reset();
+    std::size_t size();
+
+    // Read every complete record in the journal file at path
+    static std::vector<std::string> readRecords(const std::string& path);
+};
+
+#endif
@@ -1,85 +1,506 @@
 #include "library.hpp"
+#include "snapshot.hpp"
 #include "utils.hpp"
+#include <sys/stat.h>
 #include <algorithm>
-#include <fstream>
+#include <future>
+#include <unordered_set>
 #include <sstream>
 #include <iostream>
-#include <set>
+#include <iomanip>
+#include <limits>
+#include <mutex>
+#include <shared_mutex>
 
-Library::Library() : isInitialized(false) {
+Library::Library(const std::string& dataDir)
+    : isInitialized(false)
+    , dataDir(dataDir)
+    , booksPath(dataDir + "/books.txt")
+    , usersPath(dataDir + "/users.txt")
+    , snapshotPath(dataDir + "/snapshot.bin")
+    , policiesPath(dataDir + "/policies.txt")
+    , journal(dataDir + "/journal.log")
+    , checkpointInterval(1000)
+    , foldThreshold(1000)
+    , checkpointWanted(false)
+    , checkpointerStopping(false)
+    , transactionLog(dataDir + "/transactions.txt")
+    , historyArchive(dataDir + "/history_archive.txt")
+    , sharedEmails(0)
+    , searchIndexBuilt(false) {
     std::cout << "Initializing Library System...\n";
 }
 
 Library::~Library() {
+    if (checkpointer.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(checkpointerMutex);
+            checkpointerStopping = true;
+        }
+        checkpointerCv.notify_one();
+        checkpointer.join();
+    }
     std::cout << "Saving Library System state...\n";
-    saveData();
+    checkpoint();
+    journal.close();
+    transactionLog.close();  // writes out anything still queued
+    historyArchive.close();
 }
 
 void Library::loadData() {
     std::cout << "Loading data from files...\n";
     books.clear();
     users.clear();
+    dueCalendar.clear();
+    finesLedger.clear();
+    userIndex.clear();
+    emailIndex.clear();
+    sharedEmails = 0;
+    searchIndex.clear();
+    searchIndexBuilt = false;
 
-    std::string bookData = Utils::readFromFile("data/books.txt");
-    std::istringstream bookSS(bookData);
-    std::string line;
-    std::set<std::string> loadedBookIds;
-
-    while (std::getline(bookSS, line)) {
-        if (!line.empty()) {
-            auto book = Book::deserialize(line);
-            if (loadedBookIds.find(book.getId()) == loadedBookIds.end()) {
-                books.push_back(std::make_unique<Book>(book));
-                loadedBookIds.insert(book.getId());
-                std::cout << "Loaded book: " << books.back()->getTitle() << "\n";
+    Snapshot snapshot;
+    if (snapshotIsCurrent() && snapshot.open(snapshotPath)) {
+        // Materialize records on the worker pool, then index them in order
+        std::vector<std::unique_ptr<Book>> loadedBooks(snapshot.bookCount());
+        std::vector<std::unique_ptr<User>> loadedUsers(snapshot.userCount());
+        std::size_t chunk = 4096;
+        std::size_t bookChunks = (loadedBooks.size() + chunk - 1) / chunk;
+        std::size_t userChunks = (loadedUsers.size() + chunk - 1) / chunk;
+        Utils::parallelFor(bookChunks + userChunks, [&](std::size_t c) {
+            bool isBook = c < bookChunks;
+            std::size_t first = (isBook ? c : c - bookChunks) * chunk;
+            std::size_t last = std::min(first + chunk, isBook ? loadedBooks.size() : loadedUsers.size());
+            for (std::size_t i = first; i < last; ++i) {
+                if (isBook) {
+                    loadedBooks[i] = snapshot.loadBook(i);
+                } else {
+                    loadedUsers[i] = snapshot.loadUser(i);
+                }
             }
+        });
+
+        books.reserve(loadedBooks.size());
+        users.reserve(loadedUsers.size());
+        userIndex.reserve(loadedUsers.size());
+        for (auto& book : loadedBooks) {
+            insertBook(std::move(book));
+        }
+        for (auto& user : loadedUsers) {
+            insertUser(std::move(user));
+        }
+        std::cout << "Loaded " << books.size() << " book(s) and " << users.size()
+                  << " user(s) from " << snapshotPath << "\n";
+    } else {
+        loadTextFiles();
+    }
+
+    // Reset all book statuses to AVAILABLE for test mode
+    books.setAllStatuses(BookStatus::AVAILABLE);
+}
+
+// The binary snapshot is used unless a text file was edited after it
+bool Library::snapshotIsCurrent() const {
+    struct stat snapshotStat;
+    if (::stat(snapshotPath.c_str(), &snapshotStat) != 0) return false;
+
+    for (const std::string* path : {&booksPath, &usersPath}) {
+        struct stat textStat;
+        if (::stat(path->c_str(), &textStat) != 0) continue;
+        if (textStat.st_mtim.tv_sec > snapshotStat.st_mtim.tv_sec ||
+            (textStat.st_mtim.tv_sec == snapshotStat.st_mtim.tv_sec &&
+             textStat.st_mtim.tv_nsec > snapshotStat.st_mtim.tv_nsec)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+namespace {
+// Files smaller than this are parsed as a single chunk
+const std::size_t MIN_CHUNK_BYTES = 256 * 1024;
+
+template <typename T>
+struct ParsedLine {
+    std::size_t line;
+    std::unique_ptr<T> record;
+    ParseError error;
+    bool duplicate = false;
+};
+
+// Split text into up to `parts` chunks, each ending on a line boundary
+std::vector<std::string_view> splitAtLines(std::string_view text, std::size_t parts) {
+    std::vector<std::string_view> chunks;
+    std::size_t chunkSize = text.size() / parts + 1;
+    std::size_t start = 0;
+    while (start < text.size()) {
+        std::size_t end = std::min(start + chunkSize, text.size());
+        if (end < text.size()) {
+            std::size_t newline = text.find('\n', end);
+            end = newline == std::string_view::npos ? text.size() : newline + 1;
+        }
+        chunks.push_back(text.substr(start, end - start));
+        start = end;
+    }
+    return chunks;
+}
+
+// Parse every non-empty line on the worker pool. The result is in file
+// order with file line numbers, whatever the chunking was.
+template <typename T, typename Parse>
+std::vector<ParsedLine<T>> parseLines(std::string_view text, Parse parse) {
+    std::size_t parts = std::min(Utils::workerCount(), text.size() / MIN_CHUNK_BYTES + 1);
+    std::vector<std::string_view> chunks = splitAtLines(text, parts);
+    std::vector<std::vector<ParsedLine<T>>> parsed(chunks.size());
+    std::vector<std::size_t> lineCounts(chunks.size(), 0);
+
+    Utils::parallelFor(chunks.size(), [&](std::size_t c) {
+        LineReader lines(chunks[c]);
+        std::string_view line;
+        while (lines.next(line)) {
+            if (line.empty()) continue;
+            ParsedLine<T> entry;
+            entry.line = lines.line();
+            entry.record = parse(line, entry.error);
+            parsed[c].push_back(std::move(entry));
         }
+        lineCounts[c] = lines.line();
+    });
+
+    std::vector<ParsedLine<T>> result;
+    std::size_t firstLine = 0;
+    for (std::size_t c = 0; c < chunks.size(); ++c) {
+        for (auto& entry : parsed[c]) {
+            entry.line += firstLine;
+            result.push_back(std::move(entry));
+        }
+        firstLine += lineCounts[c];
     }
+    return result;
+}
 
-    // Load users
-    std::string userData = Utils::readFromFile("data/users.txt");
-    std::istringstream userSS(userData);
-    std::set<std::string> loadedUserIds;
+// First occurrence of an ID wins. IDs are sharded by hash and every shard
+// is checked by its own worker, walking the lines in file order, so the
+// outcome does not depend on scheduling.
+template <typename T>
+void markDuplicates(std::vector<ParsedLine<T>>& lines) {
+    std::size_t shards = Utils::workerCount();
+    std::vector<std::vector<std::size_t>> members(shards);
+    std::hash<Id> hasher;
+    for (std::size_t i = 0; i < lines.size(); ++i) {
+        if (lines[i].record) {
+            members[hasher(lines[i].record->getId()) % shards].push_back(i);
+        }
+    }
 
-    while (std::getline(userSS, line)) {
-        if (!line.empty()) {
-            User* user = User::deserialize(line);
-            if (user && loadedUserIds.find(user->getId()) == loadedUserIds.end()) {
-                users.push_back(std::unique_ptr<User>(user));
-                loadedUserIds.insert(user->getId());
-                std::cout << "Loaded user: " << users.back()->getName() << "\n";
+    Utils::parallelFor(shards, [&](std::size_t shard) {
+        std::unordered_set<Id> seen;
+        seen.reserve(members[shard].size());
+        for (std::size_t i : members[shard]) {
+            if (!seen.insert(lines[i].record->getId()).second) {
+                lines[i].duplicate = true;
             }
         }
+    });
+}
+}
+
+void Library::loadTextFiles() {
+    std::string bookData;
+    std::string userData;
+    std::vector<ParsedLine<Book>> parsedBooks;
+    std::vector<ParsedLine<User>> parsedUsers;
+
+    // Books and users are read and parsed at the same time
+    auto usersDone = std::async(std::launch::async, [&]() {
+        userData = Utils::readFromFile(usersPath);
+        parsedUsers = parseLines<User>(userData, User::parse);
+        markDuplicates(parsedUsers);
+    });
+    bookData = Utils::readFromFile(booksPath);
+    parsedBooks = parseLines<Book>(bookData, Book::parse);
+    markDuplicates(parsedBooks);
+    usersDone.get();
+
+    // Merge in file order
+    books.reserve(parsedBooks.size());
+    for (auto& entry : parsedBooks) {
+        if (!entry.record) {
+            entry.error.line = entry.line;
+            std::cout << "Error: " << booksPath << " " << entry.error.describe() << "\n";
+        } else if (entry.duplicate || !insertBook(std::move(entry.record))) {
+            std::cout << "Error: " << booksPath << " line " << entry.line
+                      << ", field 'id': duplicate, record skipped\n";
+        } else {
+            std::cout << "Loaded book: " << books.book(books.size() - 1)->getTitle() << "\n";
+        }
     }
 
-    // Reset all book statuses to AVAILABLE for test mode
-    for (const auto& book : books) {
-        book->setStatus(BookStatus::AVAILABLE);
+    users.reserve(parsedUsers.size());
+    userIndex.reserve(parsedUsers.size());
+    for (auto& entry : parsedUsers) {
+        if (!entry.record) {
+            entry.error.line = entry.line;
+            std::cout << "Error: " << usersPath << " " << entry.error.describe() << "\n";
+        } else if (entry.duplicate || !insertUser(std::move(entry.record))) {
+            std::cout << "Error: " << usersPath << " line " << entry.line
+                      << ", field 'id': duplicate, record skipped\n";
+        } else {
+            std::cout << "Loaded user: " << users.back()->getName() << "\n";
+        }
     }
 }
 
-void Library::saveData() const {
-    if (!isInitialized) return;  // Don't save if not initialized
+bool Library::saveData() const {
+    if (!isInitialized) return true;  // Don't save if not initialized
 
     std::cout << "Saving data to files...\n";
     std::stringstream bookSS;
-    for (const auto& book : books) {
+    for (const auto& book : books.all()) {
         bookSS << book->serialize() << "\n";
     }
-    Utils::saveToFile("data/books.txt", bookSS.str());
+    if (!Utils::saveToFile(booksPath, bookSS.str())) {
+        std::cout << "Error: Could not save " << booksPath << "\n";
+        return false;
+    }
 
     std::stringstream userSS;
     for (const auto& user : users) {
         userSS << user->serialize() << "\n";
     }
-    Utils::saveToFile("data/users.txt", userSS.str());
+    if (!Utils::saveToFile(usersPath, userSS.str())) {
+        std::cout << "Error: Could not save " << usersPath << "\n";
+        return false;
+    }
+
+    // Written last so it is never older than the text files
+    if (!Snapshot::write(snapshotPath, books.all(), users)) return false;
     std::cout << "Data saved successfully.\n";
+    return true;
+}
+
+void Library::checkpoint() {
+    if (!isInitialized) return;
+
+    // Snapshot files are replaced atomically before the journal is dropped;
+    // a crash in between just replays records the snapshot already holds
+    std::unique_lock<std::shared_mutex> quiesce(checkpointMutex);
+    foldJournal();
+}
+
+void Library::foldJournal() {
+    // Archived loans must be on disk before users.txt stops carrying them,
+    // and every file (and its directory entry) before the journal goes
+    if (!historyArchive.sync()) {
+        std::cout << "Error: Could not sync the history archive; journal kept\n";
+        return;
+    }
+    if (!saveData()) {
+        std::cout << "Error: Checkpoint failed; journal kept\n";
+        return;
+    }
+    journal.reset();
+    foldThreshold = std::max(checkpointInterval, (books.size() + users.size()) / FOLD_RATIO);
+}
+
+// Move closed loans beyond the recent window of every account to the archive
+std::size_t Library::archiveHistories() {
+    std::size_t archived = 0;
+    for (const auto& user : users) {
+        std::vector<BorrowRecord> trimmed = user->getAccount().trimHistory();
+        if (!trimmed.empty() && historyArchive.append(user->getId(), trimmed)) {
+            archived += trimmed.size();
+        }
+    }
+    return archived;
+}
+
+std::size_t Library::replayJournal() {
+    std::string journalPath = dataDir + "/journal.log";
+    std::vector<std::string> records = Journal::readRecords(journalPath);
+    if (records.empty()) return 0;
+
+    std::cout << "Replaying " << records.size() << " journal record(s)...\n";
+    for (std::size_t i = 0; i < records.size(); ++i) {
+        ParseError error;
+        if (!applyJournalRecord(records[i], error)) {
+            // One damaged record must not stop the rest from replaying
+            error.line = i + 1;
+            std::cout << "Error: " << journalPath << " " << error.describe()
+                      << ", record skipped\n";
+        }
+    }
+    return records.size();
+}
+
+// Records are "OP|payload". Applying one is idempotent, so a journal that
+// overlaps the snapshot can be replayed safely. False (and error filled)
+// for a damaged record, which is not applied.
+bool Library::applyJournalRecord(std::string_view record, ParseError& error) {
+    FieldReader reader(record);
+    std::string_view op;
+    if (!reader.next('|', op) || reader.atEnd()) {
+        return parseFailure(error, "op", "expected OP|payload");
+    }
+    std::string_view payload = reader.rest();
+
+    if (op == "PUT_BOOK") {
+        std::unique_ptr<Book> book = Book::parse(payload, error);
+        if (!book) return false;
+        if (Book* existing = lookupBook(book->getId())) {
+            BookStatus status = existing->getStatus();
+            eraseBook(book->getId());
+            book->setStatus(status);  // status is owned by BORROW/RETURN records
+        }
+        insertBook(std::move(book));
+    } else if (op == "DEL_BOOK" || op == "DEL_USER") {
+        Id id;
+        if (!Id::parse(payload, id)) return parseFailure(error, "id", "malformed ID");
+        if (op == "DEL_BOOK") {
+            eraseBook(id);
+        } else {
+            eraseUser(id);
+        }
+    } else if (op == "PUT_USER") {
+        std::unique_ptr<User> user = User::parse(payload, error);
+        if (!user) return false;
+        eraseUser(user->getId());
+        insertUser(std::move(user));
+    } else if (op == "BORROW" || op == "RETURN" || op == "ACCRUE") {
+        std::string_view userField, bookField, value;
+        Id userId, bookId;
+        if (!reader.next('|', userField) || !Id::parse(userField, userId)) {
+            return parseFailure(error, "user", "malformed ID");
+        }
+        if (!reader.next('|', bookField) || !Id::parse(bookField, bookId)) {
+            return parseFailure(error, "book", "malformed ID");
+        }
+        if (op == "ACCRUE") {
+            double accrued = 0.0;
+            if (!reader.next('|', value) || !parseNumber(value, accrued)) {
+                return parseFailure(error, "fine", "expected a number");
+            }
+            if (User* user = lookupUser(userId)) {
+                user->getAccount().setAccruedFine(bookId, accrued);
+            }
+            return true;
+        }
+
+        long long time = 0;
+        if (!reader.next('|', value) || !parseNumber(value, time)) {
+            return parseFailure(error, "time", "expected a number");
+        }
+        User* user = lookupUser(userId);
+        Book* book = lookupBook(bookId);
+        if (!user || !book) return true;
+
+        std::time_t when = static_cast<std::time_t>(time);
+        Account& account = user->getAccount();
+        std::time_t borrowDate = 0;
+        if (op == "BORROW") {
+            book->setStatus(BookStatus::BORROWED);
+            if (!account.hasOpenLoan(bookId)) {
+                account.addBorrowedBook(bookId, when);
+                dueCalendar.add(userId, bookId, user->dueDate(when));
+            }
+        } else {
+            book->setStatus(BookStatus::AVAILABLE);
+            if (account.getOpenLoanDate(bookId, borrowDate)) {
+                dueCalendar.remove(userId, bookId, user->dueDate(borrowDate));
+            }
+            account.returnBook(bookId, when);
+        }
+    } else if (op == "FINE") {
+        std::string_view userField, value;
+        Id userId;
+        double fine = 0.0;
+        if (!reader.next('|', userField) || !Id::parse(userField, userId)) {
+            return parseFailure(error, "user", "malformed ID");
+        }
+        if (!reader.next('|', value) || !parseNumber(value, fine)) {
+            return parseFailure(error, "fine", "expected a number");
+        }
+        if (User* user = lookupUser(userId)) {
+            user->getAccount().updateFine(fine);
+            finesLedger.set(user->getId(), user->getAccount().getFine());
+        }
+    } else {
+        return parseFailure(error, "op", "unknown record type");
+    }
+    return true;
+}
+
+std::uint64_t Library::appendRecord(const std::string& record) {
+    if (!isInitialized) {
+        // Still loading or seeding defaults: the first checkpoint covers it
+        return 0;
+    }
+    return journal.append(record);
+}
+
+void Library::finishCommit(std::uint64_t seq) {
+    if (seq == 0) return;
+    if (!journal.waitDurable(seq)) {
+        // Already applied in memory; a checkpoint writes the whole state out
+        // and clears the journal failure
+        std::cout << "Error: Journal " << journal.error()
+                  << "; the change is applied but not saved until the next checkpoint.\n";
+        requestCheckpoint();
+        return;
+    }
+    if (journal.size() >= foldThreshold) requestCheckpoint();
+}
+
+void Library::requestCheckpoint() {
+    {
+        std::lock_guard<std::mutex> lock(checkpointerMutex);
+        checkpointWanted = true;  // requests made before the fold starts share it
+    }
+    checkpointerCv.notify_one();
+}
+
+void Library::checkpointerLoop() {
+    std::unique_lock<std::mutex> lock(checkpointerMutex);
+    while (true) {
+        checkpointerCv.wait(lock, [this] { return checkpointerStopping || checkpointWanted; });
+        if (checkpointerStopping) break;  // the destructor checkpoints
+        checkpointWanted = false;
+        lock.unlock();
+        checkpoint();
+        lock.lock();
+    }
+}
+
+std::uint64_t Library::logBook(const Book* book) {
+    return appendRecord("PUT_BOOK|" + book->serialize());
+}
+
+std::uint64_t Library::logUser(const User* user) {
+    return appendRecord("PUT_USER|" + user->serialize());
+}
+
+std::uint64_t Library::logFine(const User* user) {
+    std::ostringstream ss;
+    ss << std::setprecision(std::numeric_limits<double>::max_digits10)
+       << "FINE|" << user->getId() << "|" << user->getAccount().getFine();
+    return appendRecord(ss.str());
 }
 
 void Library::initialize() {
     if (isInitialized) return;  // Prevent multiple initializations
 
+    // Loan rules first: due dates of the loaded loans depend on them
+    struct stat policiesStat;
+    if (::stat(policiesPath.c_str(), &policiesStat) == 0 && RolePolicies::load(policiesPath)) {
+        std::cout << "Loaded loan rules from " << policiesPath << "\n";
+    }
+    historyArchive.open();
     loadData();
+    bool needsCheckpoint = replayJournal() > 0 || books.empty() || users.empty();
+    if (std::size_t archived = archiveHistories()) {
+        std::cout << "Archived " << archived << " closed loan(s) from borrow histories.\n";
+        needsCheckpoint = true;
+    }
 
     // Only add default books if none exist
     if (books.empty()) {
@@ -116,178 +537,641 @@ void Library::initialize() {
     }
 
     isInitialized = true;  // Mark as initialized after successful setup
+
+    // Fold any recovered journal tail (and seeded defaults) into the snapshot
+    if (needsCheckpoint) {
+        checkpoint();
+    }
+    journal.open();
+    transactionLog.open();
+    checkpointer = std::thread(&Library::checkpointerLoop, this);
 }
 
-bool Library::addBook(std::unique_ptr<Book> book) {
-    books.push_back(std::move(book));
+bool Library::insertBook(std::unique_ptr<Book> book) {
+    if (!book) return false;
+    Book* inserted = book.get();
+    if (!books.insert(std::move(book))) {
+        return false;  // ID already present
+    }
+    Id::observe(inserted->getId());  // later generated IDs stay clear of it
+    inserted->owner = this;
+    if (searchIndexBuilt) searchIndex.add(inserted);
     return true;
 }
 
-bool Library::removeBook(const std::string& bookId) {
-    auto it = std::find_if(books.begin(), books.end(),
-        [&bookId](const auto& book) { return book->getId() == bookId; });
+bool Library::insertUser(std::unique_ptr<User> user) {
+    if (!user) return false;
+    if (userIndex.count(user->getId())) return false;  // ID already present
 
-    if (it != books.end()) {
-        books.erase(it);
-        return true;
+    // New users with a taken email are refused by addUser; stored ones are
+    // never dropped for it
+    std::string email = Utils::normalizeEmail(user->getEmail());
+    auto indexed = emailIndex.emplace(email, user.get());
+    if (!indexed.second) {
+        std::cout << "Warning: User " << user->getId() << " shares the email " << email
+                  << " with user " << indexed.first->second->getId()
+                  << "; email lookups find the latter.\n";
+        ++sharedEmails;
     }
-    return false;
+    Id::observe(user->getId());
+    userIndex[user->getId()] = users.size();
+    user->owner = this;
+    indexDueDates(user.get());
+    finesLedger.set(user->getId(), user->getAccount().getFine());
+    users.push_back(std::move(user));
+    return true;
 }
 
-Book* Library::findBook(const std::string& bookId) {
-    auto it = std::find_if(books.begin(), books.end(),
-        [&bookId](const auto& book) { return book->getId() == bookId; });
+bool Library::eraseBook(Id bookId) {
+    Book* book = books.find(bookId);
+    if (!book) return false;
 
-    return it != books.end() ? it->get() : nullptr;
+    if (searchIndexBuilt) searchIndex.remove(book);
+    books.erase(bookId);
+    return true;
 }
 
-std::vector<Book*> Library::searchBooks(const std::string& query) {
-    std::vector<Book*> results;
-    for (const auto& book : books) {
-        if (book->getTitle().find(query) != std::string::npos ||
-            book->getAuthor().find(query) != std::string::npos ||
-            book->getIsbn().find(query) != std::string::npos) {
-            results.push_back(book.get());
+bool Library::eraseUser(Id userId) {
+    auto it = userIndex.find(userId);
+    if (it == userIndex.end()) return false;
+
+    std::size_t pos = it->second;
+    userIndex.erase(it);
+    unindexEmail(users[pos].get());
+    unindexDueDates(users[pos].get());
+    finesLedger.remove(userId);
+    if (pos != users.size() - 1) {
+        users[pos] = std::move(users.back());
+        userIndex[users[pos]->getId()] = pos;
+    }
+    users.pop_back();
+    return true;
+}
+
+// Drop the user's email entry, handing it to another user with the same
+// email if one was loaded
+void Library::unindexEmail(const User* user) {
+    std::string email = Utils::normalizeEmail(user->getEmail());
+    auto it = emailIndex.find(email);
+    if (it == emailIndex.end() || it->second != user) return;
+    emailIndex.erase(it);
+    if (sharedEmails == 0) return;
+    for (const auto& other : users) {
+        if (other.get() != user && Utils::normalizeEmail(other->getEmail()) == email) {
+            emailIndex.emplace(email, other.get());
+            return;
         }
     }
-    return results;
 }
 
-bool Library::addUser(std::unique_ptr<User> user) {
-    users.push_back(std::move(user));
+Book* Library::lookupBook(Id bookId) const {
+    return books.find(bookId);
+}
+
+User* Library::lookupUser(Id userId) const {
+    auto it = userIndex.find(userId);
+    return it != userIndex.end() ? users[it->second].get() : nullptr;
+}
+
+bool Library::addBook(std::unique_ptr<Book> book) {
+    std::uint64_t seq;
+    {
+        std::shared_lock<std::shared_mutex> quiesce(checkpointMutex);
+        std::unique_lock<ShardedSharedMutex> catalogue(catalogueMutex);
+        const Book* added = book.get();
+        if (!insertBook(std::move(book))) {
+            std::cout << "Error: Book ID already exists.\n";
+            return false;
+        }
+        seq = logBook(added);
+    }
+    finishCommit(seq);
+    return true;
+}
+
+bool Library::removeBook(Id bookId) {
+    std::uint64_t seq;
+    {
+        std::shared_lock<std::shared_mutex> quiesce(checkpointMutex);
+        std::unique_lock<ShardedSharedMutex> catalogue(catalogueMutex);
+        if (!eraseBook(bookId)) return false;
+        seq = appendRecord("DEL_BOOK|" + bookId);
+    }
+    finishCommit(seq);
     return true;
 }
 
-bool Library::removeUser(const std::string& userId) {
-    auto it = std::find_if(users.begin(), users.end(),
-        [&userId](const auto& user) { return user->getId() == userId; });
+Book* Library::findBook(Id bookId) {
+    std::shared_lock<ShardedSharedMutex> catalogue(catalogueMutex);
+    return lookupBook(bookId);
+}
 
-    if (it != users.end()) {
-        users.erase(it);
-        return true;
+void Library::ensureSearchIndex() {
+    if (searchIndexBuilt.load(std::memory_order_acquire)) return;
+    // Writers are held off by the catalogue lock; this keeps readers from
+    // building it twice
+    std::lock_guard<std::mutex> lock(searchBuildMutex);
+    if (searchIndexBuilt.load(std::memory_order_relaxed)) return;
+    for (const auto& book : books.all()) {
+        searchIndex.add(book.get());
     }
-    return false;
+    searchIndexBuilt.store(true, std::memory_order_release);
 }
 
-User* Library::findUser(const std::string& userId) {
-    auto it = std::find_if(users.begin(), users.end(),
-        [&userId](const auto& user) { return user->getId() == userId; });
+std::vector<Book*> Library::searchBooks(std::string_view query) {
+    std::shared_lock<ShardedSharedMutex> catalogue(catalogueMutex);
+    ensureSearchIndex();
+    return searchIndex.search(query);
+}
 
-    return it != users.end() ? it->get() : nullptr;
+void Library::searchBooks(std::string_view query, std::vector<Book*>& results) {
+    std::shared_lock<ShardedSharedMutex> catalogue(catalogueMutex);
+    ensureSearchIndex();
+    searchIndex.search(query, results);
 }
 
-bool Library::borrowBook(const std::string& userId, const std::string& bookId) {
-    User* user = findUser(userId);
-    Book* book = findBook(bookId);
+std::size_t Library::countBooks(BookStatus status) const {
+    std::shared_lock<ShardedSharedMutex> catalogue(catalogueMutex);
+    return books.count(status);
+}
 
-    if (!user || !book) {
-        std::cout << "Error: User or book not found.\n";
-        return false;
-    }
-    if (book->getStatus() != BookStatus::AVAILABLE) {
-        std::cout << "Error: Book is not available.\n";
-        return false;
-    }
-    if (user->getAccount().getCurrentlyBorrowedBooks().size() >= user->getMaxBooks()) {
-        std::cout << "Error: User has reached maximum books limit.\n";
-        return false;
+std::vector<Book*> Library::findBooksByStatus(BookStatus status, std::size_t limit) const {
+    std::shared_lock<ShardedSharedMutex> catalogue(catalogueMutex);
+    return books.withStatus(status, limit);
+}
+
+Book* Library::findAvailableCopy(const std::string& title) const {
+    std::shared_lock<ShardedSharedMutex> catalogue(catalogueMutex);
+    for (BookStore::Row row = books.next(BookStatus::AVAILABLE, 0); row < books.size();
+         row = books.next(BookStatus::AVAILABLE, row + 1)) {
+        if (books.view(row).title() == title) return books.book(row);
     }
-    if (user->getAccount().hasFine()) {
-        std::cout << "Error: User has outstanding fines.\n";
-        return false;
+    return nullptr;
+}
+
+std::vector<Book*> Library::filterBooks(
+    const std::function<bool(const BookStore::View&)>& predicate) const {
+    std::shared_lock<ShardedSharedMutex> catalogue(catalogueMutex);
+    return books.filter(predicate);
+}
+
+void Library::updateBook(Book* book, bool searchable, const std::function<void()>& change) {
+    std::uint64_t seq;
+    {
+        std::shared_lock<std::shared_mutex> quiesce(checkpointMutex);
+        std::unique_lock<ShardedSharedMutex> catalogue(catalogueMutex);
+        searchable = searchable && searchIndexBuilt;
+        if (searchable) searchIndex.remove(book);
+        change();
+        books.refresh(book);
+        if (searchable) searchIndex.add(book);
+        seq = logBook(book);
     }
+    finishCommit(seq);
+}
 
-    // Faculty specific check for overdue books > 60 days
-    if (user->getRole() == UserRole::FACULTY) {
-        for (const auto& record : user->getAccount().getBorrowHistory()) {
-            if (record.returnDate == 0) {  // Book not returned yet
-                int daysOverdue = Utils::calculateDaysDifference(
-                    record.borrowDate + user->getMaxDays() * 24 * 60 * 60,
-                    Utils::getCurrentTime());
-                if (daysOverdue > 60) {
-                    std::cout << "Error: Faculty member has book(s) overdue for more than 60 days.\n";
-                    return false;
-                }
-            }
+bool Library::addUser(std::unique_ptr<User> user) {
+    std::uint64_t seq;
+    {
+        std::shared_lock<std::shared_mutex> quiesce(checkpointMutex);
+        std::unique_lock<ShardedSharedMutex> usersLock(usersMutex);
+        const User* added = user.get();
+        if (!user || emailIndex.count(Utils::normalizeEmail(user->getEmail())) ||
+            !insertUser(std::move(user))) {
+            std::cout << "Error: User ID or email already exists.\n";
+            return false;
         }
+        std::cout << "Creating user: " << added->getName() << " (Role: " <<
+            (added->getRole() == UserRole::STUDENT ? "Student" :
+             added->getRole() == UserRole::FACULTY ? "Faculty" : "Librarian") << ")\n";
+        seq = logUser(added);
+    }
+    finishCommit(seq);
+    return true;
+}
+
+bool Library::removeUser(Id userId) {
+    std::uint64_t seq;
+    {
+        std::shared_lock<std::shared_mutex> quiesce(checkpointMutex);
+        std::unique_lock<ShardedSharedMutex> usersLock(usersMutex);
+        if (!eraseUser(userId)) return false;
+        seq = appendRecord("DEL_USER|" + userId);
     }
+    finishCommit(seq);
+    return true;
+}
+
+User* Library::findUser(Id userId) {
+    std::shared_lock<ShardedSharedMutex> usersLock(usersMutex);
+    return lookupUser(userId);
+}
+
+// Emails typed as stored are looked up as they are; only others pay for
+// a normalized copy
+User* Library::lookupEmail(const std::string& email) const {
+    auto it = Utils::isNormalizedEmail(email) ? emailIndex.find(email)
+                                              : emailIndex.find(Utils::normalizeEmail(email));
+    return it != emailIndex.end() ? it->second : nullptr;
+}
 
-    book->setStatus(BookStatus::BORROWED);
-    user->getAccount().addBorrowedBook(bookId);
+User* Library::findUserByEmail(const std::string& email) {
+    std::shared_lock<ShardedSharedMutex> usersLock(usersMutex);
+    return lookupEmail(email);
+}
 
-    // Log transaction
-    std::ofstream transactionFile("data/transactions.txt", std::ios::app);
-    if (transactionFile) {
-        transactionFile << bookId << "|" << userId << "|" 
-                       << Utils::getCurrentTime() << "|0|0.0\n";
+User* Library::authenticate(const std::string& email, const std::string& password) {
+    std::shared_lock<ShardedSharedMutex> usersLock(usersMutex);
+    User* user = lookupEmail(email);
+    if (!user) return nullptr;
+    std::lock_guard<std::mutex> accountLock(user->accountMutex);
+    return user->authenticate(password) ? user : nullptr;
+}
+
+void Library::updateUser(User* user, const std::function<void()>& change) {
+    std::uint64_t seq;
+    {
+        std::shared_lock<std::shared_mutex> quiesce(checkpointMutex);
+        std::shared_lock<ShardedSharedMutex> usersLock(usersMutex);
+        std::lock_guard<std::mutex> accountLock(user->accountMutex);
+        change();
+        seq = logUser(user);
     }
+    finishCommit(seq);
+}
 
-    std::cout << "Book '" << book->getTitle() << "' borrowed by " << user->getName() << "\n";
+bool Library::updateUserEmail(User* user, const std::string& newEmail) {
+    std::uint64_t seq;
+    {
+        std::shared_lock<std::shared_mutex> quiesce(checkpointMutex);
+        std::unique_lock<ShardedSharedMutex> usersLock(usersMutex);
+        std::lock_guard<std::mutex> accountLock(user->accountMutex);
+        std::string normalized = Utils::normalizeEmail(newEmail);
+        auto it = emailIndex.find(normalized);
+        if (it != emailIndex.end() && it->second != user) {
+            return false;  // taken by someone else
+        }
+        unindexEmail(user);
+        emailIndex[normalized] = user;
+        user->email = newEmail;
+        seq = logUser(user);
+    }
+    finishCommit(seq);
     return true;
 }
 
-bool Library::returnBook(const std::string& userId, const std::string& bookId) {
-    User* user = findUser(userId);
-    Book* book = findBook(bookId);
+bool Library::borrowBook(Id userId, Id bookId) {
+    std::uint64_t seq;
+    {
+        std::shared_lock<std::shared_mutex> quiesce(checkpointMutex);
+        std::shared_lock<ShardedSharedMutex> catalogue(catalogueMutex);
+        std::shared_lock<ShardedSharedMutex> usersLock(usersMutex);
+        User* user = lookupUser(userId);
+        Book* book = lookupBook(bookId);
 
-    if (!user || !book) {
-        std::cout << "Error: User or book not found.\n";
-        return false;
-    }
+        if (!user || !book) {
+            std::cout << "Error: User or book not found.\n";
+            return false;
+        }
+        if (book->getStatus() != BookStatus::AVAILABLE) {
+            std::cout << "Error: Book is not available.\n";
+            return false;
+        }
 
-    book->setStatus(BookStatus::AVAILABLE);
-    user->getAccount().returnBook(bookId);
+        std::lock_guard<std::mutex> accountLock(user->accountMutex);
+        Account& account = user->getAccount();
+        if (account.getCurrentlyBorrowedBooks().size() >= user->getMaxBooks()) {
+            std::cout << "Error: User has reached maximum books limit.\n";
+            return false;
+        }
+        if (account.hasFine()) {
+            std::cout << "Error: User has outstanding fines.\n";
+            return false;
+        }
 
-    // Calculate fine
-    double fine = calculateFine(userId, bookId);
-    if (fine > 0) {
-        user->getAccount().addFine(fine);
-        std::cout << "Fine of ₹" << fine << " added for overdue book.\n";
-    }
+        // Roles with an overdue threshold (faculty: 60 days) are blocked by
+        // a long-overdue loan; only the loan due first needs checking
+        if (user->isBlockedByOverdue(Utils::getCurrentTime())) {
+            std::cout << "Error: User has book(s) overdue for more than "
+                      << user->getPolicy().overdueBlockDays << " days.\n";
+            return false;
+        }
+
+        // Only one of several patrons racing for the same copy gets past here
+        if (!book->tryChangeStatus(BookStatus::AVAILABLE, BookStatus::BORROWED)) {
+            std::cout << "Error: Book is not available.\n";
+            return false;
+        }
+
+        std::time_t now = Utils::getCurrentTime();
+        account.addBorrowedBook(bookId, now);
+        dueCalendar.add(userId, bookId, user->dueDate(now));
+        seq = appendRecord("BORROW|" + userId + "|" + bookId + "|" + std::to_string(now));
 
-    // Log transaction with return date and fine
-    std::ofstream transactionFile("data/transactions.txt", std::ios::app);
-    if (transactionFile) {
-        transactionFile << bookId << "|" << userId << "|" 
-                       << Utils::getCurrentTime() << "|" 
-                       << Utils::getCurrentTime() << "|" << fine << "\n";
+        // Log transaction
+        transactionLog.log(bookId + "|" + userId + "|" + std::to_string(now) + "|0|0.0");
+
+        std::cout << "Book '" << book->getTitle() << "' borrowed by " << user->getName() << "\n";
     }
+    finishCommit(seq);
+    return true;
+}
+
+bool Library::returnBook(Id userId, Id bookId) {
+    std::uint64_t seq;
+    {
+        std::shared_lock<std::shared_mutex> quiesce(checkpointMutex);
+        std::shared_lock<ShardedSharedMutex> catalogue(catalogueMutex);
+        std::shared_lock<ShardedSharedMutex> usersLock(usersMutex);
+        User* user = lookupUser(userId);
+        Book* book = lookupBook(bookId);
+
+        if (!user || !book) {
+            std::cout << "Error: User or book not found.\n";
+            return false;
+        }
+
+        std::lock_guard<std::mutex> accountLock(user->accountMutex);
+        Account& account = user->getAccount();
+        std::time_t now = Utils::getCurrentTime();
+        std::time_t borrowDate = 0;
+        bool dated = account.getOpenLoanDate(bookId, borrowDate);
+        double accrued = account.getAccruedFine(bookId);
+        if (!account.returnBook(bookId, now)) {
+            std::cout << "Error: Book is not borrowed by this user.\n";
+            return false;
+        }
+
+        // Journal the return before the copy can be borrowed again, so the
+        // next BORROW of this book always follows it in the journal
+        seq = appendRecord("RETURN|" + userId + "|" + bookId + "|" + std::to_string(now));
+        book->setStatus(BookStatus::AVAILABLE);
+
+        // Calculate fine from the loan just closed, less what accrual
+        // already charged while it was open
+        double fine = 0.0;
+        if (dated) {
+            dueCalendar.remove(userId, bookId, user->dueDate(borrowDate));
+            fine = user->calculateFine(
+                       Utils::calculateDaysDifference(user->dueDate(borrowDate), now)) - accrued;
+            fine = std::max(fine, 0.0);
+        }
+        if (fine > 0) {
+            account.addFine(fine);
+            finesLedger.set(userId, account.getFine());
+            seq = logFine(user);
+            std::cout << "Fine of ₹" << fine << " added for overdue book.\n";
+        }
+
+        // Old closed loans leave the account for the archive
+        historyArchive.append(userId, account.trimHistory());
+
+        // Log transaction with return date and fine
+        std::ostringstream record;
+        record << bookId << "|" << userId << "|" << (dated ? borrowDate : now) << "|" << now << "|"
+               << fine;
+        transactionLog.log(record.str());
 
-    std::cout << "Book '" << book->getTitle() << "' returned by " << user->getName() << "\n";
+        std::cout << "Book '" << book->getTitle() << "' returned by " << user->getName() << "\n";
+    }
+    finishCommit(seq);
     return true;
 }
 
-double Library::calculateFine(const std::string& userId, const std::string& bookId) {
-    User* user = findUser(userId);
-    if (!user) return 0.0;
+std::vector<Id> Library::getBorrowedBookIds(Id userId) {
+    std::shared_lock<ShardedSharedMutex> usersLock(usersMutex);
+    User* user = lookupUser(userId);
+    if (!user) return {};
+
+    std::lock_guard<std::mutex> accountLock(user->accountMutex);
+    return user->getAccount().getCurrentlyBorrowedBooks();
+}
 
-    for (const auto& record : user->getAccount().getBorrowHistory()) {
+double Library::fineFor(const User* user, Id bookId) const {
+    // Most recent return of the book
+    const auto& history = user->getAccount().getBorrowHistory();
+    for (auto it = history.rbegin(); it != history.rend(); ++it) {
+        const BorrowRecord& record = *it;
         if (record.bookId == bookId && record.returnDate > 0) {
             int daysOverdue = Utils::calculateDaysDifference(
-                record.borrowDate + user->getMaxDays() * 24 * 60 * 60,
-                record.returnDate);
+                user->dueDate(record.borrowDate), record.returnDate);
             return user->calculateFine(daysOverdue);
         }
     }
     return 0.0;
 }
 
-void Library::clearFine(const std::string& userId) {
-    User* user = findUser(userId);
-    if (user) {
+double Library::calculateFine(Id userId, Id bookId) {
+    std::shared_lock<ShardedSharedMutex> usersLock(usersMutex);
+    User* user = lookupUser(userId);
+    if (!user) return 0.0;
+
+    std::lock_guard<std::mutex> accountLock(user->accountMutex);
+    return fineFor(user, bookId);
+}
+
+void Library::addFine(Id userId, double amount) {
+    std::uint64_t seq;
+    {
+        std::shared_lock<std::shared_mutex> quiesce(checkpointMutex);
+        std::shared_lock<ShardedSharedMutex> usersLock(usersMutex);
+        User* user = lookupUser(userId);
+        if (!user) return;
+
+        std::lock_guard<std::mutex> accountLock(user->accountMutex);
+        user->getAccount().addFine(amount);
+        finesLedger.set(userId, user->getAccount().getFine());
+        seq = logFine(user);
+    }
+    finishCommit(seq);
+}
+
+void Library::clearFine(Id userId) {
+    std::uint64_t seq;
+    {
+        std::shared_lock<std::shared_mutex> quiesce(checkpointMutex);
+        std::shared_lock<ShardedSharedMutex> usersLock(usersMutex);
+        User* user = lookupUser(userId);
+        if (!user) return;
+
+        std::lock_guard<std::mutex> accountLock(user->accountMutex);
         user->getAccount().clearFine();
+        finesLedger.remove(userId);
+        seq = logFine(user);
+    }
+    finishCommit(seq);
+}
+
+double Library::getFine(Id userId) {
+    std::shared_lock<ShardedSharedMutex> usersLock(usersMutex);
+    User* user = lookupUser(userId);
+    if (!user) return 0.0;
+
+    std::lock_guard<std::mutex> accountLock(user->accountMutex);
+    return user->getAccount().getFine();
+}
+
+std::vector<BorrowRecord> Library::getBorrowHistory(Id userId) {
+    std::vector<BorrowRecord> recent;
+    {
+        std::shared_lock<ShardedSharedMutex> usersLock(usersMutex);
+        User* user = lookupUser(userId);
+        if (!user) return {};
+
+        std::lock_guard<std::mutex> accountLock(user->accountMutex);
+        recent = user->getAccount().getBorrowHistory();
     }
+    std::vector<BorrowRecord> history = historyArchive.read(userId);
+    history.insert(history.end(), recent.begin(), recent.end());
+    return history;
 }
 
-const std::vector<std::unique_ptr<User>>& Library::getAllUsers() const {
-    return users;
+std::vector<User*> Library::getAllUsers() const {
+    std::shared_lock<ShardedSharedMutex> usersLock(usersMutex);
+    std::vector<User*> result;
+    result.reserve(users.size());
+    for (const auto& user : users) {
+        result.push_back(user.get());
+    }
+    return result;
 }
 
-bool Library::resetUserAccount(const std::string& userId) {
-    User* user = findUser(userId);
-    if (user) {
+bool Library::resetUserAccount(Id userId) {
+    std::uint64_t seq;
+    {
+        std::shared_lock<std::shared_mutex> quiesce(checkpointMutex);
+        std::shared_lock<ShardedSharedMutex> usersLock(usersMutex);
+        User* user = lookupUser(userId);
+        if (!user) return false;
+
+        std::lock_guard<std::mutex> accountLock(user->accountMutex);
+        unindexDueDates(user);
         user->getAccount() = Account(); // Reset to fresh account
-        return true;
+        finesLedger.remove(userId);
+        historyArchive.forget(userId);
+        seq = logUser(user);
     }
-    return false;
-}
\ No newline at end of file
+    finishCommit(seq);
+    return true;
+}
+
+void Library::indexDueDates(const User* user) {
+    for (const auto& loan : user->getAccount().getOpenLoansByDate()) {
+        dueCalendar.add(user->getId(), loan.second, user->dueDate(loan.first));
+    }
+}
+
+void Library::unindexDueDates(const User* user) {
+    for (const auto& loan : user->getAccount().getOpenLoansByDate()) {
+        dueCalendar.remove(user->getId(), loan.second, user->dueDate(loan.first));
+    }
+}
+
+std::vector<DueCalendar::Loan> Library::getLoansDueOn(std::time_t day) {
+    return dueCalendar.dueOn(day);
+}
+
+std::vector<DueCalendar::Loan> Library::getLoansDueWithin(int days, std::time_t now) {
+    return dueCalendar.dueBetween(now, now + static_cast<std::time_t>(days) * 24 * 60 * 60);
+}
+
+std::vector<DueCalendar::Loan> Library::getOverdueLoans(int minDays, std::time_t now) {
+    return dueCalendar.overdueBy(minDays, now);
+}
+
+std::vector<FineBatch::UserTotal> Library::projectFines(std::time_t now) {
+    const std::size_t USERS_PER_BATCH = 4096;
+    std::vector<FineBatch::UserTotal> totals;
+
+    std::shared_lock<ShardedSharedMutex> usersLock(usersMutex);
+    totals.resize(users.size());
+    std::size_t batches = (users.size() + USERS_PER_BATCH - 1) / USERS_PER_BATCH;
+    Utils::parallelFor(batches, [&](std::size_t b) {
+        std::size_t first = b * USERS_PER_BATCH;
+        std::size_t last = std::min(first + USERS_PER_BATCH, users.size());
+        FineBatch batch;
+        for (std::size_t i = first; i < last; ++i) {
+            const User* user = users[i].get();
+            std::lock_guard<std::mutex> accountLock(user->accountMutex);
+            const Account& account = user->getAccount();
+            batch.addUser(user->getId(), account.getFine());
+            for (const auto& loan : account.getOpenLoansByDate()) {
+                batch.addLoan(user->dueDate(loan.first), user->getPolicy(),
+                              account.getAccruedFine(loan.second));
+            }
+        }
+        batch.compute(now);
+        std::vector<FineBatch::UserTotal> batchTotals = batch.totals();
+        std::copy(batchTotals.begin(), batchTotals.end(), totals.begin() + first);
+    });
+
+    totals.erase(std::remove_if(totals.begin(), totals.end(),
+                     [](const FineBatch::UserTotal& total) {
+                         return total.storedFine <= 0 && total.projectedFine <= 0;
+                     }),
+                 totals.end());
+    return totals;
+}
+
+double Library::getTotalFines() const {
+    return finesLedger.total();
+}
+
+std::size_t Library::getDebtorCount() const {
+    return finesLedger.debtors();
+}
+
+std::vector<FinesLedger::Debtor> Library::getTopDebtors(std::size_t count) const {
+    return finesLedger.top(count);
+}
+
+std::vector<FinesLedger::Debtor> Library::getDebtorsOwingMoreThan(double amount) const {
+    return finesLedger.owingMoreThan(amount);
+}
+
+double Library::accrueOverdueFines(std::time_t now) {
+    // Loans come back in due order; group them so each account is locked once
+    std::unordered_map<Id, std::vector<Id>> overdue;
+    for (const auto& loan : dueCalendar.overdueBy(1, now)) {
+        overdue[loan.userId].push_back(loan.bookId);
+    }
+
+    double charged = 0.0;
+    std::uint64_t seq = 0;
+    {
+        std::shared_lock<std::shared_mutex> quiesce(checkpointMutex);
+        std::shared_lock<ShardedSharedMutex> usersLock(usersMutex);
+        for (const auto& entry : overdue) {
+            User* user = lookupUser(entry.first);
+            if (!user) continue;
+
+            std::lock_guard<std::mutex> accountLock(user->accountMutex);
+            Account& account = user->getAccount();
+            double added = 0.0;
+            for (const auto& bookId : entry.second) {
+                std::time_t borrowDate = 0;
+                if (!account.getOpenLoanDate(bookId, borrowDate)) continue;  // returned meanwhile
+
+                double owed = user->calculateFine(
+                    Utils::calculateDaysDifference(user->dueDate(borrowDate), now));
+                double accrued = account.getAccruedFine(bookId);
+                if (owed <= accrued) continue;
+
+                account.setAccruedFine(bookId, owed);
+                std::ostringstream record;
+                record << std::setprecision(std::numeric_limits<double>::max_digits10)
+                       << "ACCRUE|" << user->getId() << "|" << bookId << "|" << owed;
+                appendRecord(record.str());
+                added += owed - accrued;
+            }
+            if (added > 0) {
+                account.addFine(added);
+                finesLedger.set(user->getId(), account.getFine());
+                seq = logFine(user);
+                charged += added;
+            }
+        }
+    }
+    finishCommit(seq);  // the last record covers everything before it
+    return charged;
+}
@@ -1,47 +1,211 @@
 #ifndef LIBRARY_HPP
 #define LIBRARY_HPP
 
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
 #include <vector>
+#include <string_view>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
 #include "book.hpp"
+#include "book_store.hpp"
 #include "user.hpp"
+#include "search_index.hpp"
+#include "journal.hpp"
+#include "transaction_logger.hpp"
+#include "history_archive.hpp"
+#include "due_calendar.hpp"
+#include "fine_batch.hpp"
+#include "fines_ledger.hpp"
+#include "sharded_mutex.hpp"
 
+// Safe to share between threads once initialize() has returned.
+// Lock order: checkpointMutex -> catalogueMutex -> usersMutex -> a user's
+// accountMutex. Book status changes are compare-and-swap on the Book
+// itself, so checkouts only ever take the container locks shared and
+// never wait on searches or reports.
 class Library {
 private:
-    std::vector<std::unique_ptr<Book>> books;
+    BookStore books;  // rows with status/year columns and an ID -> row index
     std::vector<std::unique_ptr<User>> users;
     bool isInitialized;  // Added to track initialization state
 
+    // Data file locations
+    std::string dataDir;
+    std::string booksPath;
+    std::string usersPath;
+    std::string snapshotPath;
+    std::string policiesPath;  // optional RolePolicies table
+
+    // Every mutation is journaled; the snapshot files are only rewritten
+    // when the journal is folded into them by checkpoint()
+    Journal journal;
+    std::size_t checkpointInterval;
+    // Journal records that trigger a fold: checkpointInterval, or a share
+    // of the catalogue when that is larger, since a fold rewrites it all
+    std::atomic<std::size_t> foldThreshold;
+    static const std::size_t FOLD_RATIO = 8;
+
+    // Folds run on this thread, so no committer pays for one
+    std::thread checkpointer;
+    std::mutex checkpointerMutex;
+    std::condition_variable checkpointerCv;
+    bool checkpointWanted;
+    bool checkpointerStopping;
+    void checkpointerLoop();
+    void requestCheckpoint();
+
+    // Borrow/return audit trail, written in the background
+    TransactionLogger transactionLog;
+
+    // Closed loans beyond each account's recent history
+    HistoryArchive historyArchive;
+
+    // Every dated open loan by due day, for overdue reports and accrual
+    DueCalendar dueCalendar;
+    // Every user's outstanding fine, largest first, with the running total
+    FinesLedger finesLedger;
+
+    // ID -> position in users, kept in sync so lookups are O(1)
+    std::unordered_map<Id, std::size_t> userIndex;
+    // normalized email -> user. Stored users that share an email are all
+    // loaded, and the first one loaded keeps the entry.
+    std::unordered_map<std::string, User*> emailIndex;
+    std::size_t sharedEmails;  // users loaded whose email was already indexed
+    // Built on the first search rather than at load, which it would
+    // otherwise dominate; until then book changes skip it
+    SearchIndex searchIndex;
+    std::atomic<bool> searchIndexBuilt;
+    std::mutex searchBuildMutex;
+
+    // Mutations hold this shared; checkpoint() holds it exclusively so the
+    // snapshot and the journal reset see a quiescent library
+    mutable std::shared_mutex checkpointMutex;
+    mutable ShardedSharedMutex catalogueMutex;  // books, searchIndex
+    mutable ShardedSharedMutex usersMutex;      // users, userIndex, emailIndex
+
+    // Unlocked helpers; callers hold the locks above
+    bool insertBook(std::unique_ptr<Book> book);
+    bool insertUser(std::unique_ptr<User> user);
+    bool eraseBook(Id bookId);
+    bool eraseUser(Id userId);
+    void unindexEmail(const User* user);
+    Book* lookupBook(Id bookId) const;
+    User* lookupUser(Id userId) const;
+    User* lookupEmail(const std::string& email) const;
+    void ensureSearchIndex();  // catalogueMutex held, shared is enough
+    double fineFor(const User* user, Id bookId) const;
+    void indexDueDates(const User* user);
+    void unindexDueDates(const User* user);
+
     void loadData();
-    void saveData() const;
+    void loadTextFiles();
+    bool snapshotIsCurrent() const;
+    bool saveData() const;
+    void foldJournal();  // caller holds checkpointMutex exclusively
+    std::size_t archiveHistories();
+
+    // Write-ahead journal
+    std::size_t replayJournal();
+    bool applyJournalRecord(std::string_view record, ParseError& error);
+    // appendRecord() runs under the caller's locks; finishCommit() waits
+    // for the group sync and must be called with no locks held. A change
+    // is applied once appended: if the journal fails, finishCommit reports
+    // it as not yet durable and has a checkpoint write it out.
+    std::uint64_t appendRecord(const std::string& record);
+    void finishCommit(std::uint64_t seq);
+    std::uint64_t logBook(const Book* book);
+    std::uint64_t logUser(const User* user);
+    std::uint64_t logFine(const User* user);
+
+    // Called by Book to change a field (searchable ones are re-indexed)
+    void updateBook(Book* book, bool searchable, const std::function<void()>& change);
+    friend class Book;
+
+    // Called by User to change a field under its account lock
+    void updateUser(User* user, const std::function<void()>& change);
+    bool updateUserEmail(User* user, const std::string& newEmail);
+    friend class User;
 
 public:
-    Library();
+    explicit Library(const std::string& dataDir = "data");
     ~Library();
 
     // Book management
     bool addBook(std::unique_ptr<Book> book);
-    bool removeBook(const std::string& bookId);
-    Book* findBook(const std::string& bookId);
-    std::vector<Book*> searchBooks(const std::string& query);
+    bool removeBook(Id bookId);
+    Book* findBook(Id bookId);
+    std::vector<Book*> searchBooks(std::string_view query);
+    // Into a caller-owned vector, so a reused one makes the search
+    // allocation-free
+    void searchBooks(std::string_view query, std::vector<Book*>& results);
+    // Status queries answered from the per-status bitmaps (live counts,
+    // no scan), in storage order
+    std::size_t countBooks(BookStatus status) const;
+    std::vector<Book*> findBooksByStatus(BookStatus status, std::size_t limit = SIZE_MAX) const;
+    // An available copy with this title, or nullptr; the copy still has
+    // to be won by borrowBook
+    Book* findAvailableCopy(const std::string& title) const;
+    // Column scan of the whole catalogue; the predicate runs under the
+    // catalogue lock and sees a row, not the Book
+    std::vector<Book*> filterBooks(const std::function<bool(const BookStore::View&)>& predicate) const;
 
     // User management
     bool addUser(std::unique_ptr<User> user);
-    bool removeUser(const std::string& userId);
-    User* findUser(const std::string& userId);
-    const std::vector<std::unique_ptr<User>>& getAllUsers() const;
-    bool resetUserAccount(const std::string& userId);
+    bool removeUser(Id userId);
+    User* findUser(Id userId);
+    User* findUserByEmail(const std::string& email);
+    User* authenticate(const std::string& email, const std::string& password);
+    std::vector<User*> getAllUsers() const;
+    bool resetUserAccount(Id userId);
 
     // Borrowing operations
-    bool borrowBook(const std::string& userId, const std::string& bookId);
-    bool returnBook(const std::string& userId, const std::string& bookId);
+    bool borrowBook(Id userId, Id bookId);
+    bool returnBook(Id userId, Id bookId);
+    std::vector<Id> getBorrowedBookIds(Id userId);
 
     // Fine management
-    double calculateFine(const std::string& userId, const std::string& bookId);
-    void clearFine(const std::string& userId);
+    double calculateFine(Id userId, Id bookId);
+    void addFine(Id userId, double amount);
+    void clearFine(Id userId);
+    double getFine(Id userId);
+
+    // Open loans by due date (caller's clock; defaults to now)
+    std::vector<DueCalendar::Loan> getLoansDueOn(std::time_t day);
+    std::vector<DueCalendar::Loan> getLoansDueWithin(int days, std::time_t now);
+    std::vector<DueCalendar::Loan> getOverdueLoans(int minDays, std::time_t now);
+    // Charge every overdue open loan its fine so far, one pass over the
+    // calendar; returns the amount newly charged. Returns only charge the
+    // remainder, so running this repeatedly never bills a day twice.
+    double accrueOverdueFines(std::time_t now);
+    // What every user owes plus what their open loans would add if all
+    // came back at `now`, for users with either; one batch over all open
+    // loans, split across worker threads. Charges nothing.
+    std::vector<FineBatch::UserTotal> projectFines(std::time_t now);
+    // Outstanding fines from the ledger, without visiting accounts
+    double getTotalFines() const;
+    std::size_t getDebtorCount() const;
+    std::vector<FinesLedger::Debtor> getTopDebtors(std::size_t count) const;
+    std::vector<FinesLedger::Debtor> getDebtorsOwingMoreThan(double amount) const;
+
+    // Full borrowing history, including loans moved to the archive
+    std::vector<BorrowRecord> getBorrowHistory(Id userId);
 
     // Data persistence
     void initialize();
+    void checkpoint();  // Fold the journal into the snapshot files
+    void setCheckpointInterval(std::size_t records) {
+        checkpointInterval = records;
+        foldThreshold = records;
+    }
+    void setTransactionLogPolicy(const FlushPolicy& policy) { transactionLog.setPolicy(policy); }
+    void flushTransactionLog() { transactionLog.flush(); }
+    void setTransactionLogRotation(const RotationPolicy& rotation) { transactionLog.setRotation(rotation); }
     bool isSystemInitialized() const { return isInitialized; }
 };
 
@@ -0,0 +1,198 @@
+// Load test client for `library_system --serve`.
+// Each client logs in as one of the default patrons and loops over
+// search / borrow / return until the time is up, then the run reports
+// throughput and per-request latency.
+//
+//   make loadtest
+//   ./library_system --serve 7070 &
+//   ./loadtest 7070 32 10      # endpoint, clients, seconds
+
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+// Seeded by Library::initialize() on an empty data directory
+const std::vector<std::pair<std::string, std::string>> PATRONS = {
+    {"john@example.com", "pass123"},    {"jane@example.com", "pass456"},
+    {"bob@example.com", "pass789"},     {"alice@example.com", "pass321"},
+    {"charlie@example.com", "pass654"}, {"wilson@example.com", "pass987"},
+    {"johnson@example.com", "pass654"}, {"martinez@example.com", "pass321"},
+};
+
+const std::vector<std::string> QUERIES = {"the", "harry", "tolkien", "penguin", "19", "a"};
+
+// Blocking line-oriented connection to the server
+class Client {
+private:
+    int fd = -1;
+    std::string buffer;
+
+public:
+    ~Client() {
+        if (fd >= 0) ::close(fd);
+    }
+
+    bool connect(const std::string& endpoint) {
+        if (endpoint.find_first_not_of("0123456789") == std::string::npos) {
+            sockaddr_in address{};
+            address.sin_family = AF_INET;
+            address.sin_port = htons(static_cast<uint16_t>(std::stoi(endpoint)));
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            fd = socket(AF_INET, SOCK_STREAM, 0);
+            return fd >= 0 && ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+        }
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        std::strncpy(address.sun_path, endpoint.c_str(), sizeof(address.sun_path) - 1);
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        return fd >= 0 && ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+    }
+
+    bool send(const std::string& line) {
+        std::string data = line + "\n";
+        std::size_t sent = 0;
+        while (sent < data.size()) {
+            ssize_t written = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (written <= 0) return false;
+            sent += static_cast<std::size_t>(written);
+        }
+        return true;
+    }
+
+    bool readLine(std::string& line) {
+        while (true) {
+            std::size_t newline = buffer.find('\n');
+            if (newline != std::string::npos) {
+                line = buffer.substr(0, newline);
+                buffer.erase(0, newline + 1);
+                return true;
+            }
+            char chunk[16384];
+            ssize_t received = ::read(fd, chunk, sizeof(chunk));
+            if (received <= 0) return false;
+            buffer.append(chunk, static_cast<std::size_t>(received));
+        }
+    }
+
+    // Send one request and read its reply; list replies ("OK <n>") also
+    // collect their n lines
+    bool request(const std::string& line, std::string& status, std::vector<std::string>* rows = nullptr) {
+        if (!send(line) || !readLine(status)) return false;
+        if (rows && status.compare(0, 3, "OK ") == 0) {
+            std::size_t count = std::stoul(status.substr(3));
+            rows->clear();
+            std::string row;
+            for (std::size_t i = 0; i < count; ++i) {
+                if (!readLine(row)) return false;
+                rows->push_back(row);
+            }
+        }
+        return true;
+    }
+};
+
+struct ClientStats {
+    std::vector<double> latenciesUs;
+    long failed = 0;   // ERR replies (e.g. copy already taken)
+    bool broken = false;
+};
+
+void runClient(const std::string& endpoint, std::size_t index, Clock::time_point deadline,
+               ClientStats& stats) {
+    Client client;
+    std::string status;
+    const auto& patron = PATRONS[index % PATRONS.size()];
+    if (!client.connect(endpoint) ||
+        !client.request("LOGIN " + patron.first + " " + patron.second, status) ||
+        status.compare(0, 2, "OK") != 0) {
+        stats.broken = true;
+        return;
+    }
+
+    std::mt19937 rng(static_cast<unsigned>(index + 1));
+    std::vector<std::string> rows;
+    auto timed = [&](const std::string& line, std::vector<std::string>* out) {
+        auto start = Clock::now();
+        if (!client.request(line, status, out)) {
+            stats.broken = true;
+            return false;
+        }
+        stats.latenciesUs.push_back(
+            std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+        if (status.compare(0, 2, "OK") != 0) ++stats.failed;
+        return true;
+    };
+
+    while (Clock::now() < deadline) {
+        if (!timed("SEARCH " + QUERIES[rng() % QUERIES.size()], &rows)) return;
+        if (rows.empty()) continue;
+
+        std::string bookId = rows[rng() % rows.size()];
+        bookId = bookId.substr(0, bookId.find('|'));
+        if (!timed("BORROW " + bookId, nullptr)) return;
+        if (status == "OK" && !timed("RETURN " + bookId, nullptr)) return;
+    }
+    client.send("QUIT");
+}
+
+double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0.0;
+    std::size_t rank = static_cast<std::size_t>(p * (sorted.size() - 1));
+    return sorted[rank];
+}
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cout << "Usage: " << argv[0] << " <port|socket> [clients] [seconds]\n";
+        return 1;
+    }
+    std::string endpoint = argv[1];
+    std::size_t clients = argc > 2 ? std::stoul(argv[2]) : 16;
+    int seconds = argc > 3 ? std::stoi(argv[3]) : 5;
+
+    std::vector<ClientStats> stats(clients);
+    std::vector<std::thread> threads;
+    auto start = Clock::now();
+    auto deadline = start + std::chrono::seconds(seconds);
+    for (std::size_t i = 0; i < clients; ++i) {
+        threads.emplace_back(runClient, endpoint, i, deadline, std::ref(stats[i]));
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::vector<double> latencies;
+    long failed = 0;
+    std::size_t broken = 0;
+    for (const auto& s : stats) {
+        latencies.insert(latencies.end(), s.latenciesUs.begin(), s.latenciesUs.end());
+        failed += s.failed;
+        broken += s.broken;
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    std::cout << "clients:      " << clients << " (" << broken << " disconnected)\n"
+              << "requests:     " << latencies.size() << " (" << failed << " ERR replies)\n"
+              << "throughput:   " << latencies.size() / elapsed << " req/s\n"
+              << "latency p50:  " << percentile(latencies, 0.50) << " us\n"
+              << "latency p99:  " << percentile(latencies, 0.99) << " us\n"
+              << "latency max:  " << (latencies.empty() ? 0.0 : latencies.back()) << " us\n";
+    return broken == 0 ? 0 : 1;
+}
@@ -1,8 +1,26 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
 #include <iostream>
 #include <iomanip>
 #include <limits>
+#include <random>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include "circulation_analytics.hpp"
 #include "library.hpp"
+#include "record_parser.hpp"
+#include "server.hpp"
+#include "snapshot.hpp"
+#include "transaction_segments.hpp"
 
 // Enhanced ANSI color codes for gradient effects
 const std::string ORANGE = "\033[38;2;255;165;0m";
@@ -95,27 +113,38 @@ void displayBooks(const std::vector<Book*>& books) {
     std::cout << DIM << std::string(75, HORIZONTAL_LINE[0]) << RESET << "\n";
 
     for (const auto& book : books) {
-        std::string status;
+        // Streamed piece by piece: no string is built per row
+        const std::string* color = &ORANGE;
+        const char* status = "Available";
         switch(book->getStatus()) {
             case BookStatus::AVAILABLE: 
-                status = ORANGE + "Available" + RESET; 
                 break;
             case BookStatus::BORROWED: 
-                status = PINK + "Borrowed" + RESET; 
+                color = &PINK;
+                status = "Borrowed";
                 break;
             case BookStatus::RESERVED: 
-                status = PURPLE + "Reserved" + RESET; 
+                color = &PURPLE;
+                status = "Reserved";
                 break;
         }
 
-        std::cout << std::setw(10) << book->getId()
+        char id[Id::MAX_LENGTH];
+        std::cout << std::setw(10) << std::string_view(id, book->getId().format(id))
                   << std::setw(30) << book->getTitle()
                   << std::setw(20) << book->getAuthor()
-                  << std::setw(15) << status << "\n";
+                  << *color << std::setw(15) << status << RESET << "\n";
     }
     std::cout << DIM << std::string(75, HORIZONTAL_LINE[0]) << RESET << "\n";
 }
 
+void displayAvailability(const Library& library) {
+    std::cout << ORANGE << "Available: " << library.countBooks(BookStatus::AVAILABLE) << RESET
+              << "  " << PINK << "Borrowed: " << library.countBooks(BookStatus::BORROWED) << RESET
+              << "  " << PURPLE << "Reserved: " << library.countBooks(BookStatus::RESERVED) << RESET
+              << "\n";
+}
+
 User* login(Library& library) {
     std::string email, password;
     std::cout << "Email: ";
@@ -130,12 +159,7 @@ User* login(Library& library) {
     password.erase(0, password.find_first_not_of(" \t\n\r"));
     password.erase(password.find_last_not_of(" \t\n\r") + 1);
 
-    for (const auto& user : library.getAllUsers()) {
-        if (user->getEmail() == email && user->getPassword() == password) {
-            return user.get();
-        }
-    }
-    return nullptr;
+    return library.authenticate(email, password);
 }
 
 void handleStudentFacultyMenu(Library& library, User* user) {
@@ -151,6 +175,7 @@ void handleStudentFacultyMenu(Library& library, User* user) {
                 {
                     auto books = library.searchBooks("");
                     displayBooks(books);
+                    displayAvailability(library);
                 }
                 break;
 
@@ -168,7 +193,7 @@ void handleStudentFacultyMenu(Library& library, User* user) {
                 {
                     std::cout << "Enter Book ID: ";
                     std::cin >> bookId;
-                    if (library.borrowBook(user->getId(), bookId)) {
+                    if (library.borrowBook(user->getId(), Id::fromString(bookId))) {
                         std::cout << "Book borrowed successfully!\n";
                     } else {
                         std::cout << "Failed to borrow book.\n";
@@ -180,7 +205,7 @@ void handleStudentFacultyMenu(Library& library, User* user) {
                 {
                     std::cout << "Enter Book ID: ";
                     std::cin >> bookId;
-                    if (library.returnBook(user->getId(), bookId)) {
+                    if (library.returnBook(user->getId(), Id::fromString(bookId))) {
                         std::cout << "Book returned successfully!\n";
                     } else {
                         std::cout << "Failed to return book.\n";
@@ -261,7 +286,7 @@ void handleLibrarianMenu(Library& library, User* user) {
                 {
                     std::cout << "Enter Book ID: ";
                     std::cin >> input;
-                    if (library.removeBook(input)) {
+                    if (library.removeBook(Id::fromString(input))) {
                         std::cout << "Book removed successfully!\n";
                     } else {
                         std::cout << "Failed to remove book.\n";
@@ -300,7 +325,7 @@ void handleLibrarianMenu(Library& library, User* user) {
                 {
                     std::cout << "Enter User ID: ";
                     std::cin >> input;
-                    if (library.removeUser(input)) {
+                    if (library.removeUser(Id::fromString(input))) {
                         std::cout << "User removed successfully!\n";
                     } else {
                         std::cout << "Failed to remove user.\n";
@@ -312,6 +337,7 @@ void handleLibrarianMenu(Library& library, User* user) {
                 {
                     auto books = library.searchBooks("");
                     displayBooks(books);
+                    displayAvailability(library);
                 }
                 break;
 
@@ -328,13 +354,28 @@ void handleLibrarianMenu(Library& library, User* user) {
 
             case 7: 
                 {
+                    // Stored fines come from the ledger; projections from one
+                    // batch over the open loans
                     std::cout << "\n=== Outstanding Fines ===\n";
-                    for (const auto& u : library.getAllUsers()) {
-                        if (u->getAccount().hasFine()) {
-                            std::cout << "User: " << u->getName() 
-                                     << ", Fine: ₹" << u->getAccount().getFine() << "\n";
+                    std::cout << "Total: ₹" << library.getTotalFines() << " owed by "
+                              << library.getDebtorCount() << " user(s)\n";
+                    for (const auto& debtor : library.getTopDebtors(50)) {
+                        if (User* u = library.findUser(debtor.userId)) {
+                            std::cout << "User: " << u->getName() << ", Fine: ₹" << debtor.fine << "\n";
                         }
                     }
+
+                    double projected = 0.0;
+                    std::cout << "\n=== Due On Return Today ===\n";
+                    for (const auto& fine : library.projectFines(Utils::getCurrentTime())) {
+                        if (fine.projectedFine <= 0) continue;
+                        if (User* u = library.findUser(fine.userId)) {
+                            std::cout << "User: " << u->getName() << ", Overdue loans: " << fine.overdueLoans
+                                      << ", Due on return: ₹" << fine.projectedFine << "\n";
+                        }
+                        projected += fine.projectedFine;
+                    }
+                    std::cout << "Total: ₹" << projected << " more if every overdue book came back today\n";
                 }
                 break;
 
@@ -365,13 +406,9 @@ void runTests(Library& library) {
 
     // Test Faculty login and functionality
     std::cout << "\n1. Testing Faculty Class (Inheritance & Polymorphism):\n";
-    User* faculty = nullptr;
-    for (const auto& user : library.getAllUsers()) {
-        if (user->getEmail() == "wilson@example.com" && user->getPassword() == "pass987") {
-            faculty = user.get();
-            std::cout << "Faculty login successful: " << faculty->getName() << std::endl;
-            break;
-        }
+    User* faculty = library.authenticate("wilson@example.com", "pass987");
+    if (faculty) {
+        std::cout << "Faculty login successful: " << faculty->getName() << std::endl;
     }
 
     if (faculty) {
@@ -389,14 +426,11 @@ void runTests(Library& library) {
 
         // Test borrowing limits with actual book IDs
         std::cout << "\nb) Testing Faculty borrowing rules:\n";
-        std::vector<std::string> facultyBookIds;
+        std::vector<Id> facultyBookIds;
 
         // Get first 6 available books
-        for (const auto& book : library.searchBooks("")) {
-            if (book->getStatus() == BookStatus::AVAILABLE) {
-                facultyBookIds.push_back(book->getId());
-                if (facultyBookIds.size() >= 6) break;
-            }
+        for (Book* book : library.findBooksByStatus(BookStatus::AVAILABLE, 6)) {
+            facultyBookIds.push_back(book->getId());
         }
 
         for (size_t i = 0; i < facultyBookIds.size(); i++) {
@@ -412,13 +446,9 @@ void runTests(Library& library) {
 
     // Test Student functionality
     std::cout << "\n2. Testing Student Class (Inheritance & Polymorphism):\n";
-    User* student = nullptr;
-    for (const auto& user : library.getAllUsers()) {
-        if (user->getEmail() == "john@example.com" && user->getPassword() == "pass123") {
-            student = user.get();
-            std::cout << "Student login successful: " << student->getName() << std::endl;
-            break;
-        }
+    User* student = library.authenticate("john@example.com", "pass123");
+    if (student) {
+        std::cout << "Student login successful: " << student->getName() << std::endl;
     }
 
     if (student) {
@@ -436,14 +466,11 @@ void runTests(Library& library) {
 
         // Test borrowing and fine system with different book IDs
         std::cout << "\nb) Testing Student borrowing rules:\n";
-        std::vector<std::string> studentBookIds;
+        std::vector<Id> studentBookIds;
 
         // Get next 4 available books
-        for (const auto& book : library.searchBooks("")) {
-            if (book->getStatus() == BookStatus::AVAILABLE) {
-                studentBookIds.push_back(book->getId());
-                if (studentBookIds.size() >= 4) break;
-            }
+        for (Book* book : library.findBooksByStatus(BookStatus::AVAILABLE, 4)) {
+            studentBookIds.push_back(book->getId());
         }
 
         for (size_t i = 0; i < studentBookIds.size(); i++) {
@@ -456,7 +483,7 @@ void runTests(Library& library) {
 
                 if (i == 2) { // Add fine after third successful borrow
                     std::cout << "Adding fine to test borrowing restriction..." << std::endl;
-                    student->getAccount().addFine(50.0);
+                    library.addFine(student->getId(), 50.0);
                 }
             }
         }
@@ -465,7 +492,429 @@ void runTests(Library& library) {
     std::cout << "\nOOP Implementation Verification completed.\n";
 }
 
+// Concurrency check: many threads borrow and return at random while others
+// search, then the library is checked for lost or doubled checkouts.
+// Runs against a scratch data directory so data/ is never touched.
+bool runStressTest() {
+    char dirTemplate[] = "/tmp/library-stress-XXXXXX";
+    if (!mkdtemp(dirTemplate)) {
+        std::cout << "Error: Cannot create a scratch directory.\n";
+        return false;
+    }
+    const std::string dataDir = dirTemplate;
+    const int workers = std::max(8u, 2 * std::thread::hardware_concurrency());
+    const int opsPerWorker = 2000;
+    const int raceRounds = 50;
+
+    // The library reports every call on stdout; park it on /dev/null
+    std::cout.flush();
+    int savedStdout = dup(STDOUT_FILENO);
+    int devNull = open("/dev/null", O_WRONLY);
+    dup2(devNull, STDOUT_FILENO);
+    close(devNull);
+
+    std::vector<std::string> failures;
+    std::atomic<long> borrowed{0};
+    std::atomic<long> returned{0};
+    int raceWinners = 0;
+    {
+        Library library(dataDir);
+        library.initialize();
+        library.setCheckpointInterval(500);  // checkpoint under load too
+        library.setTransactionLogRotation({false, 16 * 1024});  // and roll the log over
+
+        for (int i = 0; i < 40; ++i) {
+            library.addBook(std::make_unique<Book>("Stress Title " + std::to_string(i), "Author",
+                                                   "Publisher", 2000, "isbn-" + std::to_string(i)));
+        }
+        for (int i = 0; i < 16; ++i) {
+            library.addUser(std::make_unique<Student>("Stress Student " + std::to_string(i),
+                                                      "stress" + std::to_string(i) + "@example.com",
+                                                      "pass"));
+        }
+
+        std::vector<Id> bookIds;
+        for (Book* book : library.searchBooks("")) bookIds.push_back(book->getId());
+        std::vector<Id> userIds;
+        for (User* user : library.getAllUsers()) {
+            if (user->getRole() != UserRole::LIBRARIAN) userIds.push_back(user->getId());
+        }
+
+        // Random borrow/return traffic with searches running alongside
+        std::atomic<bool> done{false};
+        std::vector<std::thread> threads;
+        for (int t = 0; t < workers; ++t) {
+            threads.emplace_back([&, t]() {
+                std::mt19937 rng(t + 1);
+                std::vector<std::pair<Id, Id>> mine;  // this thread's loans
+                for (int i = 0; i < opsPerWorker; ++i) {
+                    Id userId = userIds[rng() % userIds.size()];
+                    Id bookId = bookIds[rng() % bookIds.size()];
+                    if (rng() % 2 == 0) {
+                        if (library.borrowBook(userId, bookId)) {
+                            ++borrowed;
+                            mine.emplace_back(userId, bookId);
+                        }
+                        continue;
+                    }
+                    // Mostly return our own loans; other threads may share the user
+                    if (!mine.empty() && rng() % 5 != 0) {
+                        std::size_t pick = rng() % mine.size();
+                        std::tie(userId, bookId) = mine[pick];
+                        mine.erase(mine.begin() + pick);
+                    }
+                    if (library.returnBook(userId, bookId)) ++returned;
+                }
+            });
+        }
+        std::thread searcher([&]() {
+            while (!done) {
+                library.searchBooks("stress");
+                library.getAllUsers();
+            }
+        });
+        for (auto& thread : threads) thread.join();
+        done = true;
+        searcher.join();
+
+        // Invariants: a book is borrowed exactly when one user holds it
+        long heldBooks = 0;
+        std::unordered_map<Id, int> holders;
+        double fines = 0.0;
+        std::size_t debtors = 0;
+        for (User* user : library.getAllUsers()) {
+            fines += user->getAccount().getFine();
+            debtors += user->getAccount().hasFine();
+            const auto& held = user->getAccount().getCurrentlyBorrowedBooks();
+            if (static_cast<int>(held.size()) > user->getMaxBooks()) {
+                failures.push_back(user->getName() + " holds more than the maximum");
+            }
+            for (const auto& bookId : held) ++holders[bookId];
+            heldBooks += held.size();
+        }
+        long borrowedStatus = 0;
+        for (const auto& bookId : bookIds) {
+            Book* book = library.findBook(bookId);
+            bool isBorrowed = book->getStatus() == BookStatus::BORROWED;
+            borrowedStatus += isBorrowed;
+            if (holders[bookId] > 1) {
+                failures.push_back(bookId + " held by " + std::to_string(holders[bookId]) + " users");
+            }
+            if (isBorrowed != (holders[bookId] == 1)) {
+                failures.push_back(bookId + " status disagrees with its holders");
+            }
+        }
+        if (static_cast<long>(library.countBooks(BookStatus::BORROWED)) != borrowedStatus ||
+            library.countBooks(BookStatus::AVAILABLE) + borrowedStatus != bookIds.size() ||
+            library.findBooksByStatus(BookStatus::BORROWED).size() != static_cast<std::size_t>(borrowedStatus)) {
+            failures.push_back("status bitmaps disagree with the books");
+        }
+        if (library.getDebtorCount() != debtors || std::abs(library.getTotalFines() - fines) > 1e-6) {
+            failures.push_back("fines ledger disagrees with the accounts");
+        }
+        if (borrowed - returned != borrowedStatus || heldBooks != borrowedStatus) {
+            failures.push_back("borrows minus returns does not match books on loan");
+        }
+
+        // Every call is in the rotated log, and the segment indexes find it
+        library.flushTransactionLog();
+        const std::string logPath = dataDir + "/transactions.txt";
+        std::vector<TransactionRecord> logged = TransactionSegments::between(
+            logPath, 0, std::numeric_limits<std::time_t>::max());
+        long loggedBorrows = std::count_if(logged.begin(), logged.end(),
+                                           [](const TransactionRecord& r) { return !r.isReturn(); });
+        if (TransactionSegments::list(logPath).size() < 2 || loggedBorrows != borrowed ||
+            static_cast<long>(logged.size()) - loggedBorrows != returned) {
+            failures.push_back("transaction log segments miss calls");
+        }
+        std::size_t bookRecords = 0;
+        for (const auto& bookId : bookIds) {
+            bookRecords += TransactionSegments::bookHistory(logPath, bookId).size();
+        }
+        if (bookRecords != logged.size()) {
+            failures.push_back("segment book index misses records");
+        }
+
+        // Hand everything back, then race every user for one copy
+        for (User* user : library.getAllUsers()) {
+            std::vector<Id> held = user->getAccount().getCurrentlyBorrowedBooks();
+            for (const auto& bookId : held) library.returnBook(user->getId(), bookId);
+        }
+        Id lastCopy = bookIds.front();
+        for (int round = 0; round < raceRounds; ++round) {
+            std::atomic<int> ready{0};
+            std::atomic<int> winners{0};
+            std::vector<std::thread> racers;
+            for (const auto& userId : userIds) {
+                racers.emplace_back([&, userId]() {
+                    ++ready;
+                    while (ready < static_cast<int>(userIds.size())) std::this_thread::yield();
+                    if (library.borrowBook(userId, lastCopy)) ++winners;
+                });
+            }
+            for (auto& racer : racers) racer.join();
+            if (winners != 1) {
+                failures.push_back("race round " + std::to_string(round) + " had " +
+                                   std::to_string(winners) + " winners");
+            }
+            raceWinners += winners;
+            for (const auto& userId : userIds) library.returnBook(userId, lastCopy);
+        }
+    }
+
+    std::cout.flush();
+    dup2(savedStdout, STDOUT_FILENO);
+    close(savedStdout);
+    std::filesystem::remove_all(dataDir);
+
+    std::cout << "Stress test: " << workers << " threads, " << workers * opsPerWorker
+              << " borrow/return calls (" << borrowed << " borrows, " << returned
+              << " returns), " << raceRounds << " races for the last copy ("
+              << raceWinners << " winners)\n";
+    for (const auto& failure : failures) {
+        std::cout << "FAIL: " << failure << "\n";
+    }
+    std::cout << (failures.empty() ? "PASS" : "FAIL") << "\n";
+    return failures.empty();
+}
+
+std::string formatUtc(std::time_t time, const char* format) {
+    std::tm utc;
+    gmtime_r(&time, &utc);
+    char text[32];
+    std::strftime(text, sizeof(text), format, &utc);
+    return text;
+}
+
+// YYYY-MM-DD as the UTC midnight starting that day
+bool parseUtcDate(const std::string& text, std::time_t& time) {
+    std::tm utc{};
+    std::istringstream in(text);
+    in >> std::get_time(&utc, "%Y-%m-%d");
+    if (in.fail() || in.peek() != std::char_traits<char>::eof()) return false;
+    time = timegm(&utc);
+    return true;
+}
+
+// Offline report over the transaction logs: totals, the most borrowed
+// titles, the busiest users and loans per day. IDs are resolved to titles
+// and names through books.txt and users.txt, read-only; ones no longer
+// there print as IDs.
+int runAnalytics(int argc, char* argv[]) {
+    std::string dataDir = "data";
+    long days = 0;  // 0: the whole log
+    long topCount = 10;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if ((arg == "--days" || arg == "--top") && i + 1 < argc) {
+            long value = 0;
+            if (!parseNumber(argv[i + 1], value) || value < 0) {
+                std::cout << "Error: " << arg << " needs a non-negative number.\n";
+                return 1;
+            }
+            (arg == "--days" ? days : topCount) = value;
+            ++i;
+        } else {
+            dataDir = arg;
+        }
+    }
+
+    std::time_t now = Utils::getCurrentTime();
+    std::time_t from = days > 0 ? now - days * 24 * 60 * 60 : 0;
+    std::time_t to = days > 0 ? now : std::numeric_limits<std::time_t>::max();
+
+    std::vector<std::string> paths = CirculationAnalytics::logFiles(dataDir);
+    CirculationStats stats;
+    auto start = std::chrono::steady_clock::now();
+    if (!CirculationAnalytics::analyze(paths, stats, from, to)) return 1;
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Resolve IDs to titles and names from the text files as of the last
+    // checkpoint, read-only: a Library would checkpoint the directory (and
+    // truncate a running server's journal) when it went away
+    std::unordered_map<std::string, std::uint64_t> byTitle;  // copies of a title share the count
+    std::vector<std::pair<std::string, std::uint64_t>> users;
+    std::vector<std::pair<Id, std::uint64_t>> topUsers =
+        CirculationStats::top(stats.borrowsByUser, topCount);
+    {
+        std::unordered_map<Id, std::string> titles;
+        std::unordered_map<Id, std::string> names;
+        for (const auto& entry : topUsers) names.emplace(entry.first, "");
+        std::string_view line;
+        ParseError error;
+
+        std::string bookData = Utils::readFromFile(dataDir + "/books.txt");
+        LineReader bookLines(bookData);
+        while (bookLines.next(line)) {
+            std::unique_ptr<Book> book = Book::parse(line, error);
+            if (book && stats.borrowsByBook.count(book->getId())) {
+                titles.emplace(book->getId(), book->getTitle());
+            }
+        }
+        std::string userData = Utils::readFromFile(dataDir + "/users.txt");
+        LineReader userLines(userData);
+        while (userLines.next(line)) {
+            std::unique_ptr<User> user = User::parse(line, error);
+            if (!user) continue;
+            auto name = names.find(user->getId());
+            if (name != names.end() && name->second.empty()) name->second = user->getName();
+        }
+
+        for (const auto& entry : stats.borrowsByBook) {
+            auto title = titles.find(entry.first);
+            byTitle[title != titles.end() ? title->second : entry.first.str()] += entry.second;
+        }
+        for (const auto& entry : topUsers) {
+            const std::string& name = names[entry.first];
+            users.emplace_back(entry.first.str() + (name.empty() ? "" : " " + name), entry.second);
+        }
+    }
+
+    std::cout << createHeader("Circulation Analytics") << "\n"
+              << "Files: " << paths.size() << ", " << stats.bytes << " bytes, " << stats.lines
+              << " records (" << stats.malformed << " malformed) in " << std::fixed
+              << std::setprecision(3) << seconds * 1000 << " ms";
+    if (seconds > 0) std::cout << " (" << std::setprecision(1) << stats.bytes / seconds / 1e6 << " MB/s)";
+    std::cout << "\n" << std::setprecision(2)
+              << "Borrows: " << stats.borrows << ", returns: " << stats.returns
+              << ", fines: ₹" << stats.fines << "\n"
+              << "Average loan: " << stats.averageLoanDays() << " days over " << stats.timedLoans
+              << " returns\n";
+
+    std::vector<std::pair<std::string, std::uint64_t>> titles(byTitle.begin(), byTitle.end());
+    std::sort(titles.begin(), titles.end(), [](const auto& a, const auto& b) {
+        return a.second != b.second ? a.second > b.second : a.first < b.first;
+    });
+    if (titles.size() > static_cast<std::size_t>(topCount)) titles.resize(topCount);
+    std::cout << "\n=== Most Borrowed Titles ===\n";
+    for (const auto& title : titles) {
+        std::cout << std::setw(8) << title.second << "  " << title.first << "\n";
+    }
+
+    std::cout << "\n=== Most Active Users ===\n";
+    for (const auto& user : users) {
+        std::cout << std::setw(8) << user.second << "  " << user.first << "\n";
+    }
+
+    std::cout << "\n=== Loans Per Day ===\n"
+              << "Date        Borrows  Returns\n";
+    for (const auto& entry : stats.byDay) {
+        std::time_t day = static_cast<std::time_t>(entry.first) * 24 * 60 * 60;
+        std::cout << formatUtc(day, "%Y-%m-%d") << " " << std::setw(8) << entry.second.borrows << " "
+                  << std::setw(8) << entry.second.returns << "\n";
+    }
+    return 0;
+}
+
+// Queries over the segmented transaction log, read through the segment
+// indexes: book <BookID> | between <from> <to> (YYYY-MM-DD, both days
+// included) | compact <days> (merge segments older than that), each
+// optionally followed by the data directory
+int runTransactionsCommand(int argc, char* argv[]) {
+    std::string command = argc > 2 ? argv[2] : "";
+    int operands = command == "between" ? 2 : 1;
+    if ((command != "book" && command != "between" && command != "compact") ||
+        argc < 3 + operands) {
+        std::cout << "Usage: --transactions book <BookID> | between <YYYY-MM-DD> <YYYY-MM-DD>"
+                     " | compact <days> [dataDir]\n";
+        return 1;
+    }
+    std::string logPath = std::string(argc > 3 + operands ? argv[3 + operands] : "data") +
+                          "/transactions.txt";
+
+    if (command == "compact") {
+        long days = 0;
+        if (!parseNumber(argv[3], days) || days < 0) {
+            std::cout << "Error: compact needs a non-negative number of days.\n";
+            return 1;
+        }
+        std::size_t before = TransactionSegments::list(logPath).size();
+        std::size_t removed =
+            TransactionSegments::compact(logPath, Utils::getCurrentTime() - days * 24 * 60 * 60);
+        std::cout << "Merged away " << removed << " of " << before << " log files.\n";
+        return 0;
+    }
+
+    std::vector<TransactionRecord> records;
+    if (command == "book") {
+        Id bookId;
+        if (!Id::parse(argv[3], bookId)) {
+            std::cout << "Error: Invalid book ID.\n";
+            return 1;
+        }
+        records = TransactionSegments::bookHistory(logPath, bookId);
+    } else {
+        std::time_t from = 0, to = 0;
+        if (!parseUtcDate(argv[3], from) || !parseUtcDate(argv[4], to)) {
+            std::cout << "Error: Dates must be YYYY-MM-DD.\n";
+            return 1;
+        }
+        records = TransactionSegments::between(logPath, from, to + 24 * 60 * 60);
+    }
+
+    std::cout << std::fixed << std::setprecision(2);
+    for (const auto& record : records) {
+        std::cout << formatUtc(record.time(), "%Y-%m-%d %H:%M:%S") << "  "
+                  << (record.isReturn() ? "RETURN" : "BORROW") << "  " << record.bookId << "  "
+                  << record.userId;
+        if (record.isReturn() && record.fine > 0) std::cout << "  fine ₹" << record.fine;
+        std::cout << "\n";
+    }
+    std::cout << records.size() << " transaction(s)\n";
+    return 0;
+}
+
 int main(int argc, char* argv[]) {
+    // Offline conversion of the text data files into a binary snapshot
+    if (argc > 1 && std::string(argv[1]) == "--convert") {
+        std::string dataDir = argc > 2 ? argv[2] : "data";
+        bool ok = Snapshot::convertTextFiles(dataDir + "/books.txt", dataDir + "/users.txt",
+                                             dataDir + "/snapshot.bin");
+        return ok ? 0 : 1;
+    }
+    // One long-running process serving every client: --serve [port|socket] [dataDir]
+    if (argc > 1 && std::string(argv[1]) == "--serve") {
+        std::string endpoint = argc > 2 ? argv[2] : "7070";
+        Server::blockShutdownSignals();  // before the library starts its threads
+        Library library(argc > 3 ? argv[3] : "data");
+        library.initialize();
+
+        Server server(library);
+        bool listening = endpoint.find_first_not_of("0123456789") == std::string::npos
+                             ? server.listenTcp(std::stoi(endpoint))
+                             : server.listenUnix(endpoint);
+        if (!listening) return 1;
+        server.run();
+        return 0;
+    }
+    // Reports from the transaction logs: --analytics [dataDir] [--days N] [--top K]
+    if (argc > 1 && std::string(argv[1]) == "--analytics") {
+        return runAnalytics(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--transactions") {
+        return runTransactionsCommand(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--stress") {
+        return runStressTest() ? 0 : 1;
+    }
+    // Nightly batch: report due dates and charge fines on overdue loans
+    if (argc > 1 && std::string(argv[1]) == "--accrue-fines") {
+        Library library(argc > 2 ? argv[2] : "data");
+        library.initialize();
+
+        std::time_t now = Utils::getCurrentTime();
+        std::cout << "Loans due today: " << library.getLoansDueOn(now).size() << "\n"
+                  << "Loans due in the next 7 days: " << library.getLoansDueWithin(7, now).size() << "\n"
+                  << "Loans overdue: " << library.getOverdueLoans(1, now).size() << "\n"
+                  << "Loans overdue by 30+ days: " << library.getOverdueLoans(30, now).size() << "\n";
+        double projected = 0.0;
+        for (const auto& fine : library.projectFines(now)) projected += fine.projectedFine;
+        std::cout << "Fines to accrue: ₹" << projected << "\n";
+        double charged = library.accrueOverdueFines(now);
+        std::cout << "Fines accrued: ₹" << charged << "\n";
+        return 0;
+    }
+
     Library library;
     library.initialize();
 
@@ -500,13 +949,7 @@ int main(int argc, char* argv[]) {
                 std::string password;
                 std::getline(std::cin >> std::ws, password);
 
-                User* user = nullptr;
-                for (const auto& u : library.getAllUsers()) {
-                    if (u->getEmail() == email && u->authenticate(password)) {
-                        user = u.get();
-                        break;
-                    }
-                }
+                User* user = library.authenticate(email, password);
 
                 if (user) {
                     std::cout << "Login successful: " << user->getName() << "\n";
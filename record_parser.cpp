@@ -0,0 +1,9 @@
+#include "record_parser.hpp"
+#include <sstream>
+
+std::string ParseError::describe() const {
+    std::ostringstream ss;
+    if (line > 0) ss << "line " << line << ", ";
+    ss << "field '" << field << "': " << message;
+    return ss.str();
+}
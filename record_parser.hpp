@@ -0,0 +1,98 @@
+#ifndef RECORD_PARSER_HPP
+#define RECORD_PARSER_HPP
+
+#include <charconv>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+// Where and why a record failed to parse
+struct ParseError {
+    std::size_t line = 0;     // 1-based; 0 when not parsing a file
+    std::string field;        // name of the offending field
+    std::string message;
+
+    std::string describe() const;
+};
+
+// Single-pass tokenizer over a record held in a string_view.
+// Fields are returned as views into the original text; nothing is copied
+// unless the caller keeps the field.
+class FieldReader {
+private:
+    std::string_view text;
+    std::size_t pos;
+    bool exhausted;
+
+public:
+    FieldReader(std::string_view text, std::size_t start = 0)
+        : text(text), pos(start), exhausted(start > text.size()) {}
+
+    // Next field up to delim (or end of text); false once the text is used up
+    bool next(char delim, std::string_view& field) {
+        if (exhausted) return false;
+        std::size_t end = text.find(delim, pos);
+        if (end == std::string_view::npos) {
+            field = text.substr(pos);
+            exhausted = true;
+        } else {
+            field = text.substr(pos, end - pos);
+            pos = end + 1;
+        }
+        return true;
+    }
+
+    // Everything not yet consumed
+    std::string_view rest() const {
+        return exhausted ? std::string_view() : text.substr(pos);
+    }
+
+    bool atEnd() const { return exhausted || pos >= text.size(); }
+};
+
+// Splits a file buffer into lines without copying, tracking line numbers
+class LineReader {
+private:
+    std::string_view text;
+    std::size_t pos;
+    std::size_t lineNumber;
+
+public:
+    explicit LineReader(std::string_view text) : text(text), pos(0), lineNumber(0) {}
+
+    bool next(std::string_view& line) {
+        if (pos >= text.size()) return false;
+        std::size_t end = text.find('\n', pos);
+        if (end == std::string_view::npos) end = text.size();
+        line = text.substr(pos, end - pos);
+        pos = end + 1;
+        ++lineNumber;
+        return true;
+    }
+
+    std::size_t line() const { return lineNumber; }
+};
+
+// Whole-field numeric conversion through std::from_chars
+template <typename T>
+bool parseNumber(std::string_view field, T& value) {
+    if (field.empty()) return false;
+    const char* first = field.data();
+    const char* last = field.data() + field.size();
+    if (*first == '+') {
+        ++first;  // from_chars rejects a leading '+'
+        if (first == last || *first == '-') return false;  // "+-5"
+    }
+    auto result = std::from_chars(first, last, value);
+    return result.ec == std::errc() && result.ptr == last;
+}
+
+// Fill error and return false; keeps the parsers' early returns one-liners
+inline bool parseFailure(ParseError& error, const char* field, const char* message) {
+    error.field = field;
+    error.message = message;
+    return false;
+}
+
+#endif
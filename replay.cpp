@@ -0,0 +1,283 @@
+// Replays a transactions log (as written by Library) through borrowBook and
+// returnBook on a scratch copy of a data directory, then reports throughput,
+// latency and how the final loans and fines differ from the recorded ones.
+//
+// Usage:
+//   ./replay [--data DIR] [--log FILE] [--threads N] [--speed X]
+//   ./replay --synthetic EVENTS [--books N] [--users N] [--threads N] [--speed X]
+//
+// --speed 0 replays as fast as possible (default); 1 keeps the recorded
+// pace, 60 plays a recorded minute per second. Events are split across
+// threads by user, so each patron's own borrows and returns stay in order.
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include "library.hpp"
+#include "record_parser.hpp"
+#include "synthetic_data.hpp"
+#include "utils.hpp"
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+struct Event {
+    std::time_t time;
+    bool borrow;
+    Id bookId;
+    Id userId;
+    double fine;
+};
+
+struct ThreadStats {
+    std::vector<double> latenciesUs;
+    long borrowOk = 0, borrowFailed = 0;
+    long returnOk = 0, returnFailed = 0;
+};
+
+// Every line is BookID|UserID|BorrowDate|ReturnDate|Fine; a line with a
+// return date is a return at that time, otherwise a borrow
+std::vector<Event> parseLog(const std::string& text, std::size_t& malformed) {
+    std::vector<Event> events;
+    LineReader lines(text);
+    std::string_view line;
+    while (lines.next(line)) {
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        if (line.empty() || line.front() == '#') continue;
+
+        FieldReader reader(line);
+        std::string_view bookField, userField, borrowField, returnField, fineField;
+        Id bookId, userId;
+        long long borrowDate = 0, returnDate = 0;
+        double fine = 0.0;
+        if (!reader.next('|', bookField) || !Id::parse(bookField, bookId) ||
+            !reader.next('|', userField) || !Id::parse(userField, userId) ||
+            !reader.next('|', borrowField) || !parseNumber(borrowField, borrowDate) ||
+            !reader.next('|', returnField) || !parseNumber(returnField, returnDate) ||
+            !reader.next('|', fineField) || !parseNumber(fineField, fine) || !reader.atEnd()) {
+            ++malformed;
+            continue;
+        }
+        bool borrow = returnDate == 0;
+        events.push_back({static_cast<std::time_t>(borrow ? borrowDate : returnDate), borrow,
+                          bookId, userId, fine});
+    }
+    std::stable_sort(events.begin(), events.end(),
+                     [](const Event& a, const Event& b) { return a.time < b.time; });
+    return events;
+}
+
+std::set<std::string> openLoans(Library& library) {
+    std::set<std::string> loans;
+    for (User* user : library.getAllUsers()) {
+        for (const auto& bookId : library.getBorrowedBookIds(user->getId())) {
+            loans.insert(user->getId() + "|" + bookId);
+        }
+    }
+    return loans;
+}
+
+double totalFines(Library& library) {
+    double total = 0.0;
+    for (User* user : library.getAllUsers()) {
+        total += library.getFine(user->getId());
+    }
+    return total;
+}
+
+double percentile(const std::vector<double>& sorted, double p) {
+    return sorted.empty() ? 0.0 : sorted[static_cast<std::size_t>(p * (sorted.size() - 1))];
+}
+}
+
+int main(int argc, char* argv[]) {
+    std::string dataDir = "data";
+    std::string logPath;
+    std::size_t threads = 4;
+    double speed = 0.0;
+    std::size_t syntheticEvents = 0;
+    SyntheticData::Config config;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string flag = argv[i];
+        std::string value = argv[i + 1];
+        if (flag == "--data") dataDir = value;
+        else if (flag == "--log") logPath = value;
+        else if (flag == "--threads") threads = std::max<std::size_t>(1, std::stoul(value));
+        else if (flag == "--speed") speed = std::stod(value);
+        else if (flag == "--synthetic") syntheticEvents = std::stoul(value);
+        else if (flag == "--books") config.books = std::stoul(value);
+        else if (flag == "--users") config.users = std::stoul(value);
+        else {
+            std::cerr << "Unknown option " << flag << "\n";
+            return 1;
+        }
+    }
+
+    // Never touch the real data: replay against a scratch copy
+    char dirTemplate[] = "/tmp/library-replay-XXXXXX";
+    if (!mkdtemp(dirTemplate)) {
+        std::cerr << "Cannot create a scratch directory\n";
+        return 1;
+    }
+    const std::string scratch = dirTemplate;
+    if (syntheticEvents > 0) {
+        config.history = 0;
+        SyntheticData::write(scratch, config);
+        logPath = scratch + "/recorded.txt";
+        SyntheticData::writeTransactions(logPath, config, syntheticEvents);
+    } else {
+        if (logPath.empty()) logPath = dataDir + "/transactions.txt";
+        for (const char* name : {"books.txt", "users.txt", "snapshot.bin", "journal.log"}) {
+            std::error_code ignored;
+            std::filesystem::copy_file(dataDir + "/" + name, scratch + "/" + name, ignored);
+        }
+    }
+
+    std::size_t malformed = 0;
+    std::vector<Event> events = parseLog(Utils::readFromFile(logPath), malformed);
+
+    // The library narrates every call; send it to /dev/null meanwhile
+    std::cout.flush();
+    int savedStdout = dup(STDOUT_FILENO);
+    int devNull = open("/dev/null", O_WRONLY);
+    dup2(devNull, STDOUT_FILENO);
+    close(devNull);
+
+    std::vector<ThreadStats> stats(threads);
+    std::set<std::string> expected, actual;
+    double recordedFines = 0.0, replayFines = 0.0;
+    double elapsed = 0.0;
+    bool swapped = false;
+    {
+        Library library(scratch);
+        library.initialize();
+
+        // The log header and the writer have disagreed on the column order;
+        // go by which column actually holds book IDs
+        std::size_t booksFirst = 0, usersFirst = 0;
+        for (std::size_t i = 0; i < std::min<std::size_t>(events.size(), 200); ++i) {
+            booksFirst += library.findBook(events[i].bookId) != nullptr;
+            usersFirst += library.findUser(events[i].bookId) != nullptr;
+        }
+        if (usersFirst > booksFirst) {
+            swapped = true;
+            for (auto& event : events) std::swap(event.bookId, event.userId);
+        }
+
+        // What the log says the loans should be once it has been applied
+        expected = openLoans(library);
+        double initialFines = totalFines(library);
+        for (const auto& event : events) {
+            std::string loan = event.userId + "|" + event.bookId;
+            if (event.borrow) {
+                expected.insert(loan);
+            } else {
+                expected.erase(loan);
+                recordedFines += event.fine;
+            }
+        }
+
+        std::vector<std::vector<const Event*>> partitions(threads);
+        std::hash<Id> hasher;
+        for (const auto& event : events) {
+            partitions[hasher(event.userId) % threads].push_back(&event);
+        }
+
+        std::time_t firstTime = events.empty() ? 0 : events.front().time;
+        auto start = Clock::now();
+        std::vector<std::thread> workers;
+        for (std::size_t t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t]() {
+                ThreadStats& s = stats[t];
+                for (const Event* event : partitions[t]) {
+                    if (speed > 0) {
+                        std::this_thread::sleep_until(
+                            start + std::chrono::duration_cast<Clock::duration>(
+                                        std::chrono::duration<double>((event->time - firstTime) / speed)));
+                    }
+                    auto opStart = Clock::now();
+                    bool ok = event->borrow ? library.borrowBook(event->userId, event->bookId)
+                                            : library.returnBook(event->userId, event->bookId);
+                    s.latenciesUs.push_back(
+                        std::chrono::duration<double, std::micro>(Clock::now() - opStart).count());
+                    if (event->borrow) {
+                        ok ? ++s.borrowOk : ++s.borrowFailed;
+                    } else {
+                        ok ? ++s.returnOk : ++s.returnFailed;
+                    }
+                }
+            });
+        }
+        for (auto& worker : workers) worker.join();
+        elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+        actual = openLoans(library);
+        replayFines = totalFines(library) - initialFines;
+    }
+
+    std::cout.flush();
+    dup2(savedStdout, STDOUT_FILENO);
+    close(savedStdout);
+    std::error_code ignored;
+    std::filesystem::remove_all(scratch, ignored);
+
+    std::vector<double> latencies;
+    ThreadStats total;
+    for (const auto& s : stats) {
+        latencies.insert(latencies.end(), s.latenciesUs.begin(), s.latenciesUs.end());
+        total.borrowOk += s.borrowOk;
+        total.borrowFailed += s.borrowFailed;
+        total.returnOk += s.returnOk;
+        total.returnFailed += s.returnFailed;
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    std::vector<std::string> missing, unexpected;
+    std::set_difference(expected.begin(), expected.end(), actual.begin(), actual.end(),
+                        std::back_inserter(missing));
+    std::set_difference(actual.begin(), actual.end(), expected.begin(), expected.end(),
+                        std::back_inserter(unexpected));
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "log:          " << (syntheticEvents ? "synthetic" : logPath) << ", "
+              << events.size() << " events (" << malformed << " malformed line(s) skipped"
+              << (swapped ? ", user/book columns swapped" : "") << ")\n"
+              << "replay:       " << threads << " thread(s), ";
+    if (speed > 0) {
+        std::cout << speed << "x recorded pace\n";
+    } else {
+        std::cout << "max speed\n";
+    }
+    std::cout
+              << "elapsed:      " << elapsed << " s\n"
+              << "throughput:   " << (elapsed > 0 ? latencies.size() / elapsed : 0.0) << " ops/s\n"
+              << "latency p50:  " << percentile(latencies, 0.50) << " us\n"
+              << "latency p99:  " << percentile(latencies, 0.99) << " us\n"
+              << "latency p999: " << percentile(latencies, 0.999) << " us\n"
+              << "latency max:  " << (latencies.empty() ? 0.0 : latencies.back()) << " us\n"
+              << "borrows:      " << total.borrowOk << " ok, " << total.borrowFailed << " failed\n"
+              << "returns:      " << total.returnOk << " ok, " << total.returnFailed << " failed\n"
+              << "open loans:   " << expected.size() << " recorded, " << actual.size()
+              << " after replay (" << missing.size() << " missing, " << unexpected.size()
+              << " unexpected)\n"
+              << std::setprecision(2)
+              << "fines:        " << recordedFines << " recorded, " << replayFines
+              << " charged by replay\n";
+    for (std::size_t i = 0; i < std::min<std::size_t>(missing.size(), 5); ++i) {
+        std::cout << "  missing loan:    " << missing[i] << "\n";
+    }
+    for (std::size_t i = 0; i < std::min<std::size_t>(unexpected.size(), 5); ++i) {
+        std::cout << "  unexpected loan: " << unexpected[i] << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,83 @@
+#include "role_policy.hpp"
+#include "record_parser.hpp"
+#include "utils.hpp"
+#include <iostream>
+
+namespace {
+const std::array<RolePolicy, 3> DEFAULT_POLICIES = {{
+    // maxBooks, loanDays, finePerDay, graceDays, maxFine, overdueBlockDays
+    {3, 15, 10.0, 0, 0.0, -1},  // Student: fined per overdue day
+    {5, 30, 0.0, 0, 0.0, 60},   // Faculty: no fines, blocked past 60 days overdue
+    {0, 0, 0.0, 0, 0.0, -1},    // Librarian: cannot borrow books
+}};
+
+bool parseRole(std::string_view name, UserRole& role) {
+    if (name == "student") role = UserRole::STUDENT;
+    else if (name == "faculty") role = UserRole::FACULTY;
+    else if (name == "librarian") role = UserRole::LIBRARIAN;
+    else return false;
+    return true;
+}
+
+bool parsePolicy(std::string_view line, UserRole& role, RolePolicy& policy, ParseError& error) {
+    FieldReader reader(line);
+    std::string_view field;
+    if (!reader.next('|', field) || !parseRole(field, role)) {
+        return parseFailure(error, "role", "expected student, faculty or librarian");
+    }
+    if (!reader.next('|', field) || !parseNumber(field, policy.maxBooks) || policy.maxBooks < 0) {
+        return parseFailure(error, "maxBooks", "expected a count >= 0");
+    }
+    if (!reader.next('|', field) || !parseNumber(field, policy.loanDays) || policy.loanDays < 0) {
+        return parseFailure(error, "loanDays", "expected days >= 0");
+    }
+    if (!reader.next('|', field) || !parseNumber(field, policy.finePerDay) || policy.finePerDay < 0) {
+        return parseFailure(error, "finePerDay", "expected an amount >= 0");
+    }
+    if (!reader.next('|', field) || !parseNumber(field, policy.graceDays) || policy.graceDays < 0) {
+        return parseFailure(error, "graceDays", "expected days >= 0");
+    }
+    if (!reader.next('|', field) || !parseNumber(field, policy.maxFine) || policy.maxFine < 0) {
+        return parseFailure(error, "maxFine", "expected an amount >= 0 (0 = no cap)");
+    }
+    if (!reader.next('|', field) || !parseNumber(field, policy.overdueBlockDays) ||
+        policy.overdueBlockDays < -1) {
+        return parseFailure(error, "overdueBlockDays", "expected days >= 0, or -1 for never");
+    }
+    if (!reader.atEnd()) {
+        return parseFailure(error, "overdueBlockDays", "unexpected trailing fields");
+    }
+    return true;
+}
+}
+
+std::array<RolePolicy, 3> RolePolicies::table = DEFAULT_POLICIES;
+
+void RolePolicies::reset() {
+    table = DEFAULT_POLICIES;
+}
+
+bool RolePolicies::load(const std::string& filename) {
+    std::string content = Utils::readFromFile(filename);
+    if (content.empty()) return false;
+
+    std::array<RolePolicy, 3> loaded = table;
+    LineReader lines(content);
+    std::string_view line;
+    while (lines.next(line)) {
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        if (line.empty() || line.front() == '#') continue;
+
+        UserRole role;
+        RolePolicy policy;
+        ParseError error;
+        error.line = lines.line();
+        if (!parsePolicy(line, role, policy, error)) {
+            std::cout << "Error: " << filename << " " << error.describe() << "\n";
+            return false;
+        }
+        loaded[static_cast<std::size_t>(role)] = policy;
+    }
+    table = loaded;
+    return true;
+}
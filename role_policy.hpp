@@ -0,0 +1,55 @@
+#ifndef ROLE_POLICY_HPP
+#define ROLE_POLICY_HPP
+
+#include <array>
+#include <cstddef>
+#include <string>
+
+// Encapsulation: Role types in enum class
+enum class UserRole {
+    STUDENT,
+    FACULTY,
+    LIBRARIAN
+};
+
+// Loan rules of one user role
+struct RolePolicy {
+    int maxBooks;          // open loans at once; 0 = may not borrow
+    int loanDays;
+    double finePerDay;     // for each overdue day past graceDays
+    int graceDays;
+    double maxFine;        // per loan; 0 = no cap
+    int overdueBlockDays;  // no new loans while one is overdue by more; -1 = never
+
+    double fine(int daysOverdue) const {
+        int charged = daysOverdue - graceDays;
+        if (charged <= 0) return 0.0;
+        double amount = charged * finePerDay;
+        return maxFine > 0 && amount > maxFine ? maxFine : amount;
+    }
+};
+
+// The rules of every role, indexed by UserRole. Users read their row on
+// each call, so a loaded table applies to existing users too. Loading is
+// not synchronized with readers: do it before the library is in use
+// (Library::initialize loads <dataDir>/policies.txt when present).
+//
+// File format, one role per line ('#' starts a comment):
+//   role|maxBooks|loanDays|finePerDay|graceDays|maxFine|overdueBlockDays
+// with role one of student, faculty, librarian. Roles not listed keep
+// their current rules.
+class RolePolicies {
+private:
+    static std::array<RolePolicy, 3> table;
+
+public:
+    static const RolePolicy& of(UserRole role) {
+        return table[static_cast<std::size_t>(role)];
+    }
+
+    static void reset();  // back to the built-in rules
+    // false (table unchanged) if the file is missing or has a bad line
+    static bool load(const std::string& filename);
+};
+
+#endif
@@ -0,0 +1,166 @@
+#include "search_index.hpp"
+#include "book.hpp"
+#include <algorithm>
+
+namespace {
+const std::size_t GRAM = 3;
+// Renumber once this many documents are gone and they outnumber the rest
+const std::size_t REBUILD_AFTER = 1024;
+}
+
+SearchIndex::SearchIndex() : removedDocs(0) {}
+
+// The characters in the low bytes, the length above them, so grams of
+// different lengths never collide
+SearchIndex::Gram SearchIndex::packGram(const char* text, std::size_t length) {
+    Gram gram = static_cast<Gram>(length);
+    for (std::size_t i = 0; i < length; ++i) {
+        gram = gram << 8 | static_cast<unsigned char>(text[i]);
+    }
+    return gram;
+}
+
+void SearchIndex::collectGrams(std::string_view text, std::vector<Gram>& out) {
+    for (std::size_t length = 1; length <= GRAM; ++length) {
+        for (std::size_t i = 0; i + length <= text.size(); ++i) {
+            out.push_back(packGram(text.data() + i, length));
+        }
+    }
+}
+
+void SearchIndex::gramsOf(const Book& book, std::vector<Gram>& grams) {
+    grams.clear();
+    collectGrams(book.getTitle(), grams);
+    collectGrams(book.getAuthor(), grams);
+    collectGrams(book.getIsbn(), grams);
+    std::sort(grams.begin(), grams.end());
+    grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+}
+
+bool SearchIndex::matches(const Book& book, std::string_view query) {
+    return book.getTitle().find(query) != std::string::npos ||
+           book.getAuthor().find(query) != std::string::npos ||
+           book.getIsbn().find(query) != std::string::npos;
+}
+
+void SearchIndex::add(Book* book) {
+    if (!book || docIds.count(book)) return;
+
+    // New documents get the largest ID, so appending keeps lists sorted
+    DocId doc = static_cast<DocId>(documents.size());
+    docIds[book] = doc;
+    documents.push_back(book);
+    static thread_local std::vector<Gram> grams;
+    gramsOf(*book, grams);
+    for (Gram gram : grams) {
+        postings[gram].push_back(doc);
+    }
+}
+
+void SearchIndex::remove(const Book* book) {
+    auto it = docIds.find(book);
+    if (it == docIds.end()) return;
+
+    DocId doc = it->second;
+    static thread_local std::vector<Gram> grams;
+    gramsOf(*book, grams);
+    for (Gram gram : grams) {
+        auto posting = postings.find(gram);
+        if (posting == postings.end()) continue;
+        auto& list = posting->second;
+        auto at = std::lower_bound(list.begin(), list.end(), doc);
+        if (at != list.end() && *at == doc) list.erase(at);
+        if (list.empty()) postings.erase(posting);
+    }
+    documents[doc] = nullptr;
+    docIds.erase(it);
+    if (++removedDocs >= REBUILD_AFTER && removedDocs * 2 > documents.size()) {
+        rebuild();
+    }
+}
+
+void SearchIndex::rebuild() {
+    std::vector<Book*> live;
+    live.reserve(documents.size() - removedDocs);
+    for (Book* book : documents) {
+        if (book) live.push_back(book);
+    }
+    clear();
+    for (Book* book : live) add(book);
+}
+
+void SearchIndex::clear() {
+    postings.clear();
+    documents.clear();
+    docIds.clear();
+    removedDocs = 0;
+}
+
+std::vector<Book*> SearchIndex::search(std::string_view query) const {
+    std::vector<Book*> results;
+    search(query, results);
+    return results;
+}
+
+void SearchIndex::search(std::string_view query, std::vector<Book*>& results) const {
+    results.clear();
+
+    // Every book contains the empty query
+    if (query.empty()) {
+        for (Book* book : documents) {
+            if (book) results.push_back(book);
+        }
+        return;
+    }
+
+    // A query no longer than a gram is one: its list is the answer
+    if (query.size() <= GRAM) {
+        auto posting = postings.find(packGram(query.data(), query.size()));
+        if (posting == postings.end()) return;
+        for (DocId doc : posting->second) results.push_back(documents[doc]);
+        return;
+    }
+
+    // Gather the posting list of every gram in the query; any missing gram
+    // means nothing can match. The scratch lists are reused per thread.
+    static thread_local std::vector<const std::vector<DocId>*> lists;
+    static thread_local std::vector<std::size_t> cursors;
+    lists.clear();
+    for (std::size_t i = 0; i + GRAM <= query.size(); ++i) {
+        auto posting = postings.find(packGram(query.data() + i, GRAM));
+        if (posting == postings.end()) return;
+        lists.push_back(&posting->second);
+    }
+    std::sort(lists.begin(), lists.end(),
+        [](const auto* a, const auto* b) { return a->size() < b->size(); });
+    lists.erase(std::unique(lists.begin(), lists.end()), lists.end());
+    cursors.assign(lists.size(), 0);
+
+    // Walk the shortest list; the others are searched forward from where
+    // the previous candidate left them
+    for (DocId doc : *lists.front()) {
+        bool inAll = true;
+        for (std::size_t i = 1; i < lists.size() && inAll; ++i) {
+            const auto& list = *lists[i];
+            // Gallop, then binary search the last step: dense lists advance
+            // one or two places, sparse ones jump
+            std::size_t low = cursors[i], step = 1;
+            while (low + step < list.size() && list[low + step] < doc) {
+                low += step;
+                step *= 2;
+            }
+            auto at = std::lower_bound(list.begin() + low,
+                                       list.begin() + std::min(low + step + 1, list.size()), doc);
+            cursors[i] = static_cast<std::size_t>(at - list.begin());
+            inAll = at != list.end() && *at == doc;
+        }
+        if (!inAll) continue;
+
+        Book* book = documents[doc];
+        // Every gram occurring somewhere doesn't make the query a
+        // substring, so confirm it
+        if (matches(*book, query)) {
+            results.push_back(book);
+        }
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef SEARCH_INDEX_HPP
+#define SEARCH_INDEX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+class Book;
+
+// Inverted index over the title, author and ISBN of every book.
+// Each field is broken into 1-, 2- and 3-character grams, and each gram
+// keeps a sorted vector of the documents holding it. A query of 1-3
+// characters is a single gram, so its list is the answer; a longer query
+// intersects the lists of its 3-character grams and confirms the survivors
+// with a substring match. Either way the results equal a substring match
+// over every book.
+class SearchIndex {
+private:
+    using Gram = std::uint32_t;
+    using DocId = std::uint32_t;
+
+    std::unordered_map<Gram, std::vector<DocId>> postings;  // ascending
+    std::vector<Book*> documents;  // by DocId, so insertion order; nullptr once removed
+    std::unordered_map<const Book*, DocId> docIds;
+    std::size_t removedDocs;
+
+    static void gramsOf(const Book& book, std::vector<Gram>& grams);
+    static void collectGrams(std::string_view text, std::vector<Gram>& out);
+    static Gram packGram(const char* text, std::size_t length);
+    static bool matches(const Book& book, std::string_view query);
+    void rebuild();
+
+public:
+    SearchIndex();
+
+    void add(Book* book);
+    void remove(const Book* book);
+    void clear();
+
+    // Books whose title, author or ISBN contains query, in insertion order
+    std::vector<Book*> search(std::string_view query) const;
+    // The same into results (cleared first); no allocation once results
+    // has the capacity
+    void search(std::string_view query, std::vector<Book*>& results) const;
+};
+
+#endif
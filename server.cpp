@@ -0,0 +1,366 @@
+#include "server.hpp"
+#include "utils.hpp"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace {
+const std::size_t MAX_LINE = 4096;
+// Stop reading from a client until it has taken this much of its replies
+const std::size_t MAX_PENDING_OUTPUT = 1 << 20;
+}
+
+Server::Server(Library& library, std::size_t workers)
+    : library(library)
+    , workers(workers ? workers : std::max<std::size_t>(4, 2 * Utils::workerCount()))
+    , epollFd(-1)
+    , listenFd(-1)
+    , stopFd(-1)
+    , signalFd(-1) {}
+
+Server::~Server() {
+    for (auto& entry : connections) {
+        ::close(entry.first);
+    }
+    for (int fd : {listenFd, signalFd, stopFd, epollFd}) {
+        if (fd >= 0) ::close(fd);
+    }
+    if (!socketPath.empty()) {
+        ::unlink(socketPath.c_str());
+    }
+}
+
+void Server::blockShutdownSignals() {
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+}
+
+bool Server::setupEpoll() {
+    if (epollFd >= 0) return true;
+
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epollFd < 0 || stopFd < 0) {
+        std::cout << "Error: Cannot create event loop: " << std::strerror(errno) << "\n";
+        return false;
+    }
+
+    // Level-triggered, so every worker wakes up and sees it
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = stopFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, stopFd, &event);
+
+    // Only delivered here if the caller blocked them beforehand
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    signalFd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (signalFd >= 0) {
+        event.data.fd = signalFd;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, signalFd, &event);
+    }
+    return true;
+}
+
+bool Server::listenTcp(int port) {
+    if (!setupEpoll()) return false;
+
+    listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int reuse = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (listenFd < 0 ||
+        bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(listenFd, SOMAXCONN) != 0) {
+        std::cout << "Error: Cannot listen on port " << port << ": " << std::strerror(errno) << "\n";
+        return false;
+    }
+
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLONESHOT;
+    event.data.fd = listenFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &event);
+    std::cout << "Listening on 127.0.0.1:" << port << "\n";
+    return true;
+}
+
+bool Server::listenUnix(const std::string& path) {
+    if (!setupEpoll()) return false;
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        std::cout << "Error: Socket path too long: " << path << "\n";
+        return false;
+    }
+    std::strcpy(address.sun_path, path.c_str());
+    ::unlink(path.c_str());  // left over from a previous run
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listenFd < 0 ||
+        bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(listenFd, SOMAXCONN) != 0) {
+        std::cout << "Error: Cannot listen on " << path << ": " << std::strerror(errno) << "\n";
+        return false;
+    }
+    socketPath = path;
+
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLONESHOT;
+    event.data.fd = listenFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &event);
+    std::cout << "Listening on " << path << "\n";
+    return true;
+}
+
+void Server::run() {
+    if (listenFd < 0) {
+        std::cout << "Error: Server is not listening.\n";
+        return;
+    }
+
+    std::cout << "Serving with " << workers << " worker thread(s)\n";
+    std::vector<std::thread> threads;
+    for (std::size_t i = 1; i < workers; ++i) {
+        threads.emplace_back(&Server::workerLoop, this);
+    }
+    workerLoop();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    std::cout << "Server stopped.\n";
+}
+
+void Server::stop() {
+    std::uint64_t one = 1;
+    if (stopFd >= 0 && ::write(stopFd, &one, sizeof(one)) < 0) {
+        std::cout << "Error: Cannot signal the server to stop.\n";
+    }
+}
+
+void Server::workerLoop() {
+    epoll_event events[16];
+    while (true) {
+        int ready = epoll_wait(epollFd, events, 16, -1);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            std::cout << "Error: epoll_wait: " << std::strerror(errno) << "\n";
+            return;
+        }
+
+        for (int i = 0; i < ready; ++i) {
+            if (events[i].data.fd == stopFd) {
+                return;
+            }
+            if (events[i].data.fd == signalFd) {
+                signalfd_siginfo info;
+                if (::read(signalFd, &info, sizeof(info)) == sizeof(info)) {
+                    std::cout << "Received signal " << info.ssi_signo << ", shutting down...\n";
+                    stop();
+                }
+                continue;
+            }
+            if (events[i].data.fd == listenFd) {
+                acceptClients();
+                continue;
+            }
+            serviceConnection(static_cast<Connection*>(events[i].data.ptr), events[i].events);
+        }
+    }
+}
+
+void Server::acceptClients() {
+    while (true) {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            break;  // EAGAIN, or out of descriptors until someone disconnects
+        }
+
+        auto connection = std::make_unique<Connection>();
+        connection->fd = fd;
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+        event.data.ptr = connection.get();
+        {
+            std::lock_guard<std::mutex> lock(connectionsMutex);
+            connections[fd] = std::move(connection);
+        }
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+    }
+
+    // Re-arm the listener (one-shot, so a single worker accepts at a time)
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLONESHOT;
+    event.data.fd = listenFd;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, listenFd, &event);
+}
+
+void Server::serviceConnection(Connection* connection, unsigned events) {
+    if (events & EPOLLERR) {
+        closeConnection(connection);
+        return;
+    }
+
+    // Read whatever has arrived
+    char buffer[16384];
+    while (!connection->closing && connection->output.size() < MAX_PENDING_OUTPUT) {
+        ssize_t received = ::read(connection->fd, buffer, sizeof(buffer));
+        if (received > 0) {
+            connection->input.append(buffer, static_cast<std::size_t>(received));
+        } else if (received == 0) {
+            connection->closing = true;  // peer is done sending
+        } else if (errno == EINTR) {
+            continue;
+        } else {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) connection->closing = true;
+            break;
+        }
+    }
+
+    // Answer every complete line
+    std::size_t start = 0;
+    while (connection->output.size() < MAX_PENDING_OUTPUT) {
+        std::size_t newline = connection->input.find('\n', start);
+        if (newline == std::string::npos) break;
+        std::string line = connection->input.substr(start, newline - start);
+        start = newline + 1;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty()) continue;
+        connection->output += handleRequest(*connection, line);
+    }
+    connection->input.erase(0, start);
+    if (connection->input.size() > MAX_LINE) {
+        connection->output += "ERR Request too long\n";
+        connection->input.clear();
+        connection->closing = true;
+    }
+
+    // Send as much of the reply as the socket takes
+    std::size_t sent = 0;
+    while (sent < connection->output.size()) {
+        ssize_t written = ::send(connection->fd, connection->output.data() + sent,
+                                 connection->output.size() - sent, MSG_NOSIGNAL);
+        if (written > 0) {
+            sent += static_cast<std::size_t>(written);
+        } else if (written < 0 && errno == EINTR) {
+            continue;
+        } else {
+            if (written < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+                closeConnection(connection);
+                return;
+            }
+            break;
+        }
+    }
+    connection->output.erase(0, sent);
+
+    if (connection->closing && connection->output.empty()) {
+        closeConnection(connection);
+        return;
+    }
+
+    epoll_event event{};
+    event.events = EPOLLRDHUP | EPOLLONESHOT;
+    if (!connection->closing && connection->output.size() < MAX_PENDING_OUTPUT) {
+        event.events |= EPOLLIN;
+    }
+    if (!connection->output.empty()) {
+        event.events |= EPOLLOUT;
+    }
+    event.data.ptr = connection;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, connection->fd, &event);
+}
+
+void Server::closeConnection(Connection* connection) {
+    int fd = connection->fd;
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    ::close(fd);
+    std::lock_guard<std::mutex> lock(connectionsMutex);
+    connections.erase(fd);
+}
+
+std::string Server::handleRequest(Connection& connection, const std::string& line) {
+    std::size_t space = line.find(' ');
+    std::string command = line.substr(0, space);
+    std::string args = space == std::string::npos ? "" : line.substr(space + 1);
+
+    if (command == "LOGIN") {
+        std::size_t split = args.find(' ');
+        if (split == std::string::npos) return "ERR Usage: LOGIN <email> <password>\n";
+        User* user = library.authenticate(args.substr(0, split), args.substr(split + 1));
+        if (!user) return "ERR Invalid credentials\n";
+
+        connection.userId = user->getId();
+        return "OK " + user->getId() + "|" + user->getName() + "|" +
+               (user->getRole() == UserRole::STUDENT ? "Student" :
+                user->getRole() == UserRole::FACULTY ? "Faculty" : "Librarian") + "\n";
+    }
+    if (command == "SEARCH") {
+        std::vector<Book*> books = library.searchBooks(args);
+        std::ostringstream reply;
+        reply << "OK " << books.size() << "\n";
+        for (const Book* book : books) {
+            reply << book->serialize() << "\n";
+        }
+        return reply.str();
+    }
+    if (command == "QUIT") {
+        connection.closing = true;
+        return "OK\n";
+    }
+
+    // Everything below acts on the logged-in user
+    if (!connection.userId.isValid()) return "ERR Not logged in\n";
+
+    if (command == "BORROW") {
+        return library.borrowBook(connection.userId, Id::fromString(args)) ? "OK\n" : "ERR Cannot borrow book\n";
+    }
+    if (command == "RETURN") {
+        return library.returnBook(connection.userId, Id::fromString(args)) ? "OK\n" : "ERR Cannot return book\n";
+    }
+    if (command == "LOANS") {
+        std::vector<Id> loans = library.getBorrowedBookIds(connection.userId);
+        std::string reply = "OK " + std::to_string(loans.size()) + "\n";
+        for (const auto& bookId : loans) {
+            reply += bookId + "\n";
+        }
+        return reply;
+    }
+    if (command == "FINE") {
+        std::ostringstream reply;
+        reply << "OK " << library.getFine(connection.userId) << "\n";
+        return reply.str();
+    }
+    if (command == "PAYFINE") {
+        library.clearFine(connection.userId);
+        return "OK\n";
+    }
+    if (command == "LOGOUT") {
+        connection.userId = Id();
+        return "OK\n";
+    }
+    return "ERR Unknown command: " + command + "\n";
+}
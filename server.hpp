@@ -0,0 +1,77 @@
+#ifndef SERVER_HPP
+#define SERVER_HPP
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "library.hpp"
+
+// Serves one shared Library to many clients over a local TCP port or Unix
+// socket. Requests and responses are single text lines:
+//
+//   LOGIN <email> <password>   OK <userId>|<name>|<role>
+//   SEARCH [query]             OK <n>, then n book records (as in books.txt)
+//   BORROW <bookId>            OK
+//   RETURN <bookId>            OK
+//   LOANS                      OK <n>, then n book IDs
+//   FINE                       OK <amount>
+//   PAYFINE                    OK
+//   LOGOUT                     OK
+//   QUIT                       OK, then the server closes the connection
+//
+// Failures answer "ERR <message>". Connections are non-blocking and driven
+// by one epoll instance shared by a few worker threads; each connection is
+// armed one-shot so only one worker handles it at a time. Borrow and return
+// wait for the journal sync, so there are more workers than cores and their
+// commits share a group sync.
+class Server {
+private:
+    struct Connection {
+        int fd;
+        std::string input;
+        std::string output;
+        Id userId;  // empty until LOGIN succeeds
+        bool closing = false;
+    };
+
+    Library& library;
+    std::size_t workers;
+    int epollFd;
+    int listenFd;
+    int stopFd;    // eventfd; readable once stop() is called
+    int signalFd;  // SIGINT/SIGTERM, if blocked by blockShutdownSignals()
+    std::string socketPath;  // Unix socket to unlink on shutdown
+
+    std::mutex connectionsMutex;
+    std::unordered_map<int, std::unique_ptr<Connection>> connections;
+
+    bool setupEpoll();
+    void workerLoop();
+    void acceptClients();
+    void serviceConnection(Connection* connection, unsigned events);
+    void closeConnection(Connection* connection);
+    std::string handleRequest(Connection& connection, const std::string& line);
+
+public:
+    explicit Server(Library& library, std::size_t workers = 0);
+    ~Server();
+
+    Server(const Server&) = delete;
+    Server& operator=(const Server&) = delete;
+
+    // Block SIGINT/SIGTERM in the calling thread (and the threads it starts
+    // afterwards) so the server can receive them through a signalfd instead.
+    // Call before anything spawns threads.
+    static void blockShutdownSignals();
+
+    bool listenTcp(int port);  // 127.0.0.1 only
+    bool listenUnix(const std::string& path);
+
+    // Serve until stop() or a shutdown signal
+    void run();
+    void stop();
+};
+
+#endif
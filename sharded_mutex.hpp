@@ -0,0 +1,54 @@
+#ifndef SHARDED_MUTEX_HPP
+#define SHARDED_MUTEX_HPP
+
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <shared_mutex>
+#include <thread>
+
+// Reader/writer lock split into per-thread shards.
+// A reader only touches the shard its thread hashes to, so concurrent
+// readers on different cores don't bounce one lock word between caches.
+// A writer takes every shard (always in the same order). Meets the
+// SharedMutex requirements, so std::shared_lock/std::unique_lock work.
+class ShardedSharedMutex {
+private:
+    static const std::size_t SHARDS = 16;
+
+    struct alignas(64) Shard {
+        std::shared_mutex mutex;
+    };
+    std::array<Shard, SHARDS> shards;
+
+    static std::size_t threadShard() {
+        static thread_local std::size_t shard =
+            std::hash<std::thread::id>()(std::this_thread::get_id()) % SHARDS;
+        return shard;
+    }
+
+public:
+    void lock() {
+        for (auto& shard : shards) shard.mutex.lock();
+    }
+
+    bool try_lock() {
+        for (std::size_t i = 0; i < SHARDS; ++i) {
+            if (!shards[i].mutex.try_lock()) {
+                while (i > 0) shards[--i].mutex.unlock();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void unlock() {
+        for (std::size_t i = SHARDS; i > 0; --i) shards[i - 1].mutex.unlock();
+    }
+
+    void lock_shared() { shards[threadShard()].mutex.lock_shared(); }
+    bool try_lock_shared() { return shards[threadShard()].mutex.try_lock_shared(); }
+    void unlock_shared() { shards[threadShard()].mutex.unlock_shared(); }
+};
+
+#endif
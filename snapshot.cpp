@@ -0,0 +1,314 @@
+#include "snapshot.hpp"
+#include "utils.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+const char MAGIC[8] = {'L', 'M', 'S', 'S', 'N', 'A', 'P', '\0'};
+
+// Accumulates the string heap while records are being built
+class HeapBuilder {
+public:
+    Snapshot::StringRef add(std::string_view text) {
+        Snapshot::StringRef ref{data.size(), text.size()};
+        data += text;
+        return ref;
+    }
+    std::string data;
+};
+
+template <typename T>
+void writeArray(std::ofstream& out, const std::vector<T>& records) {
+    out.write(reinterpret_cast<const char*>(records.data()),
+              static_cast<std::streamsize>(records.size() * sizeof(T)));
+}
+
+bool sectionFits(std::uint64_t offset, std::uint64_t count, std::size_t recordSize,
+                 std::size_t fileSize) {
+    return offset <= fileSize && count <= (fileSize - offset) / recordSize;
+}
+}
+
+Snapshot::Snapshot()
+    : mapping(nullptr)
+    , mappingSize(0)
+    , header(nullptr)
+    , bookRecords(nullptr)
+    , userRecords(nullptr)
+    , loanRecords(nullptr)
+    , historyRecords(nullptr)
+    , heap(nullptr) {}
+
+Snapshot::~Snapshot() {
+    close();
+}
+
+bool Snapshot::open(const std::string& path) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(Header)) {
+        ::close(fd);
+        return false;
+    }
+    mappingSize = static_cast<std::size_t>(st.st_size);
+    mapping = ::mmap(nullptr, mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        mapping = nullptr;
+        return false;
+    }
+
+    const char* base = static_cast<const char*>(mapping);
+    const Header* h = reinterpret_cast<const Header*>(base);
+    bool valid = std::memcmp(h->magic, MAGIC, sizeof(MAGIC)) == 0 &&
+                 h->version == VERSION &&
+                 h->headerSize == sizeof(Header) &&
+                 sectionFits(h->booksOffset, h->bookCount, sizeof(BookRecord), mappingSize) &&
+                 sectionFits(h->usersOffset, h->userCount, sizeof(UserRecord), mappingSize) &&
+                 sectionFits(h->loansOffset, h->loanCount, sizeof(std::uint64_t), mappingSize) &&
+                 sectionFits(h->historyOffset, h->historyCount, sizeof(HistoryRecord), mappingSize) &&
+                 sectionFits(h->heapOffset, h->heapSize, 1, mappingSize);
+    if (!valid) {
+        std::cout << "Error: " << path << " is not a valid version " << VERSION << " snapshot\n";
+        close();
+        return false;
+    }
+
+    header = h;
+    bookRecords = reinterpret_cast<const BookRecord*>(base + h->booksOffset);
+    userRecords = reinterpret_cast<const UserRecord*>(base + h->usersOffset);
+    loanRecords = reinterpret_cast<const std::uint64_t*>(base + h->loansOffset);
+    historyRecords = reinterpret_cast<const HistoryRecord*>(base + h->historyOffset);
+    heap = base + h->heapOffset;
+
+    // Enum bytes become BookStatus/UserRole as they are, so reject any out
+    // of range; user records index into the loan/history arrays, so reject
+    // any that would point past them
+    for (std::size_t i = 0; i < h->bookCount; ++i) {
+        if (bookRecords[i].status > static_cast<std::uint8_t>(BookStatus::RESERVED)) {
+            std::cout << "Error: " << path << " has a corrupt book record\n";
+            close();
+            return false;
+        }
+    }
+    for (std::size_t i = 0; i < h->userCount; ++i) {
+        const UserRecord& u = userRecords[i];
+        if (u.role > static_cast<std::uint8_t>(UserRole::LIBRARIAN) ||
+            u.loanBegin > h->loanCount || u.loanCount > h->loanCount - u.loanBegin ||
+            u.historyBegin > h->historyCount ||
+            u.historyCount > h->historyCount - u.historyBegin) {
+            std::cout << "Error: " << path << " has a corrupt user record\n";
+            close();
+            return false;
+        }
+    }
+    ::madvise(mapping, mappingSize, MADV_SEQUENTIAL);
+    return true;
+}
+
+void Snapshot::close() {
+    if (mapping) {
+        ::munmap(mapping, mappingSize);
+    }
+    mapping = nullptr;
+    mappingSize = 0;
+    header = nullptr;
+    bookRecords = nullptr;
+    userRecords = nullptr;
+    loanRecords = nullptr;
+    historyRecords = nullptr;
+    heap = nullptr;
+}
+
+std::string_view Snapshot::str(const StringRef& ref) const {
+    if (!header || ref.offset > header->heapSize || ref.length > header->heapSize - ref.offset) {
+        return std::string_view();
+    }
+    return std::string_view(heap + ref.offset, ref.length);
+}
+
+Id Snapshot::loan(const UserRecord& user, std::size_t i) const {
+    return Id::fromRaw(loanRecords[user.loanBegin + i]);
+}
+
+const Snapshot::HistoryRecord& Snapshot::history(const UserRecord& user, std::size_t i) const {
+    return historyRecords[user.historyBegin + i];
+}
+
+std::unique_ptr<Book> Snapshot::loadBook(std::size_t i) const {
+    const BookRecord& r = bookRecords[i];
+    return std::make_unique<Book>(Id::fromRaw(r.id), std::string(str(r.title)),
+                                  str(r.author), str(r.publisher), r.year,
+                                  std::string(str(r.isbn)),
+                                  static_cast<BookStatus>(r.status));
+}
+
+std::unique_ptr<User> Snapshot::loadUser(std::size_t i) const {
+    const UserRecord& r = userRecords[i];
+    std::unique_ptr<User> user(User::create(static_cast<UserRole>(r.role),
+                                            Id::fromRaw(r.id),
+                                            std::string(str(r.name)),
+                                            std::string(str(r.email)),
+                                            std::string(str(r.password))));
+    if (!user) return nullptr;
+
+    Account& account = user->account;
+    account.outstandingFine = r.fine;
+    account.currentlyBorrowedBooks.reserve(r.loanCount);
+    for (std::uint64_t j = 0; j < r.loanCount; ++j) {
+        account.currentlyBorrowedBooks.push_back(loan(r, j));
+    }
+    account.borrowHistory.reserve(r.historyCount);
+    for (std::uint64_t j = 0; j < r.historyCount; ++j) {
+        const HistoryRecord& h = history(r, j);
+        account.borrowHistory.push_back(BorrowRecord{
+            Id::fromRaw(h.bookId),
+            static_cast<std::time_t>(h.borrowDate),
+            static_cast<std::time_t>(h.returnDate),
+            h.accruedFine});
+    }
+    account.reindexOpenLoans();
+    return user;
+}
+
+bool Snapshot::write(const std::string& path,
+                     const std::vector<std::unique_ptr<Book>>& books,
+                     const std::vector<std::unique_ptr<User>>& users) {
+    HeapBuilder heapBuilder;
+    std::vector<BookRecord> bookOut;
+    std::vector<UserRecord> userOut;
+    std::vector<std::uint64_t> loanOut;
+    std::vector<HistoryRecord> historyOut;
+    bookOut.reserve(books.size());
+    userOut.reserve(users.size());
+
+    for (const auto& book : books) {
+        BookRecord r{};
+        r.id = book->getId().raw();
+        r.title = heapBuilder.add(book->getTitle());
+        r.author = heapBuilder.add(book->getAuthor());
+        r.publisher = heapBuilder.add(book->getPublisher());
+        r.isbn = heapBuilder.add(book->getIsbn());
+        r.year = book->getYear();
+        r.status = static_cast<std::uint8_t>(book->getStatus());
+        bookOut.push_back(r);
+    }
+
+    for (const auto& user : users) {
+        const Account& account = user->getAccount();
+        UserRecord r{};
+        r.id = user->getId().raw();
+        r.name = heapBuilder.add(user->getName());
+        r.email = heapBuilder.add(user->getEmail());
+        r.password = heapBuilder.add(user->getPassword());
+        r.fine = account.getFine();
+        r.role = static_cast<std::uint8_t>(user->getRole());
+        r.loanBegin = loanOut.size();
+        r.loanCount = account.getCurrentlyBorrowedBooks().size();
+        for (const auto& bookId : account.getCurrentlyBorrowedBooks()) {
+            loanOut.push_back(bookId.raw());
+        }
+        r.historyBegin = historyOut.size();
+        r.historyCount = account.getBorrowHistory().size();
+        for (const auto& record : account.getBorrowHistory()) {
+            historyOut.push_back(HistoryRecord{record.bookId.raw(),
+                                               static_cast<std::int64_t>(record.borrowDate),
+                                               static_cast<std::int64_t>(record.returnDate),
+                                               record.accruedFine});
+        }
+        userOut.push_back(r);
+    }
+
+    Header h{};
+    std::memcpy(h.magic, MAGIC, sizeof(MAGIC));
+    h.version = VERSION;
+    h.headerSize = sizeof(Header);
+    h.bookCount = bookOut.size();
+    h.userCount = userOut.size();
+    h.loanCount = loanOut.size();
+    h.historyCount = historyOut.size();
+    h.heapSize = heapBuilder.data.size();
+    h.booksOffset = sizeof(Header);
+    h.usersOffset = h.booksOffset + h.bookCount * sizeof(BookRecord);
+    h.loansOffset = h.usersOffset + h.userCount * sizeof(UserRecord);
+    h.historyOffset = h.loansOffset + h.loanCount * sizeof(std::uint64_t);
+    h.heapOffset = h.historyOffset + h.historyCount * sizeof(HistoryRecord);
+
+    // Same write, sync, rename, sync-directory discipline as Utils::saveToFile
+    std::string tempName = path + ".tmp";
+    std::ofstream out(tempName, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cout << "Error: Cannot write snapshot " << path << "\n";
+        return false;
+    }
+    out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    writeArray(out, bookOut);
+    writeArray(out, userOut);
+    writeArray(out, loanOut);
+    writeArray(out, historyOut);
+    out.write(heapBuilder.data.data(), static_cast<std::streamsize>(heapBuilder.data.size()));
+    out.close();
+    // The data must be on disk before the rename can expose it
+    int fd = out ? ::open(tempName.c_str(), O_RDONLY) : -1;
+    bool synced = fd >= 0 && ::fsync(fd) == 0;
+    if (fd >= 0) ::close(fd);
+    if (!synced) {
+        std::cout << "Error: Cannot write snapshot " << path << "\n";
+        return false;
+    }
+    if (std::rename(tempName.c_str(), path.c_str()) != 0 || !Utils::syncParentDirectory(path)) {
+        std::cout << "Error: Cannot write snapshot " << path << "\n";
+        return false;
+    }
+    return true;
+}
+
+bool Snapshot::convertTextFiles(const std::string& booksPath,
+                                const std::string& usersPath,
+                                const std::string& snapshotPath) {
+    std::vector<std::unique_ptr<Book>> books;
+    std::vector<std::unique_ptr<User>> users;
+    std::string_view line;
+    ParseError error;
+
+    std::string bookData = Utils::readFromFile(booksPath);
+    LineReader bookLines(bookData);
+    while (bookLines.next(line)) {
+        if (line.empty()) continue;
+        if (auto book = Book::parse(line, error)) {
+            books.push_back(std::move(book));
+        } else {
+            error.line = bookLines.line();
+            std::cout << "Error: " << booksPath << " " << error.describe() << "\n";
+            return false;
+        }
+    }
+
+    std::string userData = Utils::readFromFile(usersPath);
+    LineReader userLines(userData);
+    while (userLines.next(line)) {
+        if (line.empty()) continue;
+        if (auto user = User::parse(line, error)) {
+            users.push_back(std::move(user));
+        } else {
+            error.line = userLines.line();
+            std::cout << "Error: " << usersPath << " " << error.describe() << "\n";
+            return false;
+        }
+    }
+
+    if (!write(snapshotPath, books, users)) return false;
+    std::cout << "Converted " << books.size() << " book(s) and " << users.size()
+              << " user(s) into " << snapshotPath << "\n";
+    return true;
+}
@@ -0,0 +1,123 @@
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "book.hpp"
+#include "user.hpp"
+
+// Versioned binary snapshot of the catalogue and user base.
+// The file is a header followed by arrays of fixed-width records and one
+// string heap; every string field is an (offset, length) reference into the
+// heap and IDs are stored as their packed 64-bit value. Integers are
+// stored in host byte order. The file is mmap()ed and read in place, so
+// opening it costs nothing beyond the page faults of the records actually
+// touched.
+class Snapshot {
+public:
+    static const std::uint32_t VERSION = 4;
+
+    // 64-bit so neither the heap nor the loan/history arrays can outgrow
+    // what a record can address
+    struct StringRef {
+        std::uint64_t offset;
+        std::uint64_t length;
+    };
+
+    struct BookRecord {
+        std::uint64_t id;
+        StringRef title;
+        StringRef author;
+        StringRef publisher;
+        StringRef isbn;
+        std::int32_t year;
+        std::uint8_t status;
+        std::uint8_t reserved[3];
+    };
+
+    struct UserRecord {
+        std::uint64_t id;
+        StringRef name;
+        StringRef email;
+        StringRef password;
+        double fine;
+        std::uint8_t role;
+        std::uint8_t reserved[3];
+        std::uint64_t loanBegin;      // index into loans
+        std::uint64_t loanCount;
+        std::uint64_t historyBegin;   // index into history
+        std::uint64_t historyCount;
+    };
+
+    struct HistoryRecord {
+        std::uint64_t bookId;
+        std::int64_t borrowDate;
+        std::int64_t returnDate;
+        double accruedFine;
+    };
+
+    struct Header {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t headerSize;
+        std::uint64_t bookCount;
+        std::uint64_t userCount;
+        std::uint64_t loanCount;      // currently borrowed book IDs (uint64 each)
+        std::uint64_t historyCount;
+        std::uint64_t heapSize;
+        std::uint64_t booksOffset;
+        std::uint64_t usersOffset;
+        std::uint64_t loansOffset;
+        std::uint64_t historyOffset;
+        std::uint64_t heapOffset;
+    };
+
+private:
+    void* mapping;
+    std::size_t mappingSize;
+    const Header* header;
+    const BookRecord* bookRecords;
+    const UserRecord* userRecords;
+    const std::uint64_t* loanRecords;
+    const HistoryRecord* historyRecords;
+    const char* heap;
+
+public:
+    Snapshot();
+    ~Snapshot();
+
+    Snapshot(const Snapshot&) = delete;
+    Snapshot& operator=(const Snapshot&) = delete;
+
+    // Map and validate a snapshot file; false if missing, corrupt or from
+    // another version
+    bool open(const std::string& path);
+    void close();
+
+    std::size_t bookCount() const { return header ? header->bookCount : 0; }
+    std::size_t userCount() const { return header ? header->userCount : 0; }
+    const BookRecord& book(std::size_t i) const { return bookRecords[i]; }
+    const UserRecord& user(std::size_t i) const { return userRecords[i]; }
+    Id loan(const UserRecord& user, std::size_t i) const;
+    const HistoryRecord& history(const UserRecord& user, std::size_t i) const;
+    std::string_view str(const StringRef& ref) const;
+
+    // Materialize records as objects (bulk load)
+    std::unique_ptr<Book> loadBook(std::size_t i) const;
+    std::unique_ptr<User> loadUser(std::size_t i) const;
+
+    static bool write(const std::string& path,
+                      const std::vector<std::unique_ptr<Book>>& books,
+                      const std::vector<std::unique_ptr<User>>& users);
+
+    // Build a snapshot from the pipe-delimited books/users text files
+    static bool convertTextFiles(const std::string& booksPath,
+                                 const std::string& usersPath,
+                                 const std::string& snapshotPath);
+};
+
+#endif
@@ -0,0 +1,95 @@
+#include "status_bitmap.hpp"
+
+StatusBitmap::Block::Block() {
+    for (auto& status : words) {
+        for (auto& w : status) w.store(0, std::memory_order_relaxed);
+    }
+}
+
+StatusBitmap::StatusBitmap() : rows(0) {
+    for (auto& count : counts) count.store(0, std::memory_order_relaxed);
+}
+
+void StatusBitmap::resize(std::size_t newRows) {
+    std::size_t needed = (newRows + BLOCK_ROWS - 1) / BLOCK_ROWS;
+    while (blocks.size() < needed) blocks.emplace_back(new Block());
+    blocks.resize(needed);
+    rows = newRows;
+}
+
+void StatusBitmap::clear() {
+    blocks.clear();
+    rows = 0;
+    for (auto& count : counts) count.store(0, std::memory_order_relaxed);
+}
+
+// Counts move only with a bit that actually flipped, so they agree with
+// the bitmaps whatever order racing marks land in
+void StatusBitmap::setBit(std::size_t row, std::size_t status) {
+    std::atomic<std::uint64_t>& w = word(row, status);
+    if (!(w.fetch_or(bit(row), std::memory_order_relaxed) & bit(row))) {
+        counts[status].fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void StatusBitmap::clearBit(std::size_t row, std::size_t status) {
+    std::atomic<std::uint64_t>& w = word(row, status);
+    if (!(w.load(std::memory_order_relaxed) & bit(row))) return;
+    if (w.fetch_and(~bit(row), std::memory_order_relaxed) & bit(row)) {
+        counts[status].fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+void StatusBitmap::mark(std::size_t row, BookStatus status) {
+    for (std::size_t s = 0; s < STATUSES; ++s) {
+        if (s == index(status)) {
+            setBit(row, s);
+        } else {
+            clearBit(row, s);
+        }
+    }
+}
+
+void StatusBitmap::unmark(std::size_t row) {
+    for (std::size_t s = 0; s < STATUSES; ++s) clearBit(row, s);
+}
+
+void StatusBitmap::fill(BookStatus status) {
+    for (std::size_t b = 0; b < blocks.size(); ++b) {
+        for (std::size_t w = 0; w < BLOCK_WORDS; ++w) {
+            std::size_t first = b * BLOCK_ROWS + w * 64;
+            std::uint64_t full = 0;
+            if (first + 64 <= rows) {
+                full = ~std::uint64_t(0);
+            } else if (first < rows) {
+                full = (std::uint64_t(1) << (rows - first)) - 1;
+            }
+            for (std::size_t s = 0; s < STATUSES; ++s) {
+                blocks[b]->words[s][w].store(s == index(status) ? full : 0, std::memory_order_relaxed);
+            }
+        }
+    }
+    for (std::size_t s = 0; s < STATUSES; ++s) {
+        counts[s].store(s == index(status) ? rows : 0, std::memory_order_relaxed);
+    }
+}
+
+std::size_t StatusBitmap::next(BookStatus status, std::size_t from) const {
+    if (from >= rows) return npos;
+    std::size_t s = index(status);
+    std::size_t b = from / BLOCK_ROWS;
+    std::size_t w = from % BLOCK_ROWS / 64;
+    // Ignore the bits below `from` in its own word
+    std::uint64_t bits = blocks[b]->words[s][w].load(std::memory_order_relaxed) & (~std::uint64_t(0) << (from % 64));
+    while (true) {
+        if (bits) {
+            std::size_t row = b * BLOCK_ROWS + w * 64 + __builtin_ctzll(bits);
+            return row < rows ? row : npos;
+        }
+        if (++w == BLOCK_WORDS) {
+            w = 0;
+            if (++b == blocks.size()) return npos;
+        }
+        bits = blocks[b]->words[s][w].load(std::memory_order_relaxed);
+    }
+}
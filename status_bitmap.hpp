@@ -0,0 +1,68 @@
+#ifndef STATUS_BITMAP_HPP
+#define STATUS_BITMAP_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "book.hpp"
+
+// One bitmap per BookStatus over the rows of a BookStore: bit r of the
+// AVAILABLE bitmap is set when row r is available, and so on. Queries
+// skip 64 rows per word, and per-status counts are kept as bits flip, so
+// "how many are available" costs nothing and "find an available copy"
+// touches one bit per row instead of one Book.
+//
+// Bits change with atomic RMWs, so concurrent status changes (under the
+// shared catalogue lock) may mark rows; resize/fill/clear need the
+// exclusive one. A bit can briefly lag a status change still in flight;
+// the status column stays authoritative.
+class StatusBitmap {
+public:
+    static const std::size_t npos = static_cast<std::size_t>(-1);
+
+    StatusBitmap();
+
+    std::size_t size() const { return rows; }
+    // New rows start in no bitmap; rows dropped must be unmarked first
+    void resize(std::size_t newRows);
+    void clear();
+
+    // Put row in status's bitmap and take it out of the others
+    void mark(std::size_t row, BookStatus status);
+    void unmark(std::size_t row);
+    // Every row in status's bitmap
+    void fill(BookStatus status);
+
+    std::size_t count(BookStatus status) const {
+        return counts[index(status)].load(std::memory_order_relaxed);
+    }
+    // First row >= from in status's bitmap, or npos
+    std::size_t next(BookStatus status, std::size_t from) const;
+
+private:
+    static const std::size_t STATUSES = static_cast<std::size_t>(BookStatus::RESERVED) + 1;
+    static const std::size_t BLOCK_ROWS = 4096;
+    static const std::size_t BLOCK_WORDS = BLOCK_ROWS / 64;
+
+    // Fixed-size blocks so words never move while others flip bits
+    struct Block {
+        std::atomic<std::uint64_t> words[STATUSES][BLOCK_WORDS];
+        Block();
+    };
+
+    std::vector<std::unique_ptr<Block>> blocks;
+    std::size_t rows;
+    std::atomic<std::size_t> counts[STATUSES];
+
+    static std::size_t index(BookStatus status) { return static_cast<std::size_t>(status); }
+    static std::uint64_t bit(std::size_t row) { return std::uint64_t(1) << (row % 64); }
+    std::atomic<std::uint64_t>& word(std::size_t row, std::size_t status) const {
+        return blocks[row / BLOCK_ROWS]->words[status][row % BLOCK_ROWS / 64];
+    }
+    void setBit(std::size_t row, std::size_t status);
+    void clearBit(std::size_t row, std::size_t status);
+};
+
+#endif
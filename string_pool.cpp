@@ -0,0 +1,65 @@
+#include "string_pool.hpp"
+#include <functional>
+
+StringPool& StringPool::shared() {
+    static StringPool pool;
+    return pool;
+}
+
+// Caller holds the shard's mutex
+const char* StringPool::store(Shard& shard, std::string_view text) {
+    std::uint32_t length = static_cast<std::uint32_t>(text.size());
+    std::size_t needed = sizeof(length) + text.size();
+    char* entry;
+    if (needed > BLOCK_SIZE / 4) {
+        // Long strings get a block of their own; the partly used block stays last
+        std::unique_ptr<char[]> own(new char[needed]);
+        entry = own.get();
+        shard.blocks.insert(shard.blocks.empty() ? shard.blocks.end() : shard.blocks.end() - 1,
+                            std::move(own));
+        shard.bytes += needed;
+    } else {
+        if (shard.blockUsed + needed > BLOCK_SIZE) {
+            shard.blocks.emplace_back(new char[BLOCK_SIZE]);
+            shard.blockUsed = 0;
+            shard.bytes += BLOCK_SIZE;
+        }
+        entry = shard.blocks.back().get() + shard.blockUsed;
+        shard.blockUsed += needed;
+    }
+    std::memcpy(entry, &length, sizeof(length));
+    std::memcpy(entry + sizeof(length), text.data(), text.size());
+    return entry;
+}
+
+StringPool::Handle StringPool::intern(std::string_view text) {
+    if (text.empty()) return Handle();
+
+    Shard& shard = shards[std::hash<std::string_view>()(text) % SHARDS];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto found = shard.strings.find(text);
+    if (found != shard.strings.end()) {
+        return Handle(found->data() - sizeof(std::uint32_t));
+    }
+    const char* entry = store(shard, text);
+    shard.strings.emplace(entry + sizeof(std::uint32_t), text.size());
+    return Handle(entry);
+}
+
+std::size_t StringPool::size() const {
+    std::size_t total = 0;
+    for (const auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        total += shard.strings.size();
+    }
+    return total;
+}
+
+std::size_t StringPool::bytes() const {
+    std::size_t total = 0;
+    for (const auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        total += shard.bytes;
+    }
+    return total;
+}
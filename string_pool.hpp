@@ -0,0 +1,70 @@
+#ifndef STRING_POOL_HPP
+#define STRING_POOL_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+// Append-only pool of interned strings for catalogue text that repeats a
+// lot (authors, publishers). The text lives in arena blocks that are never
+// freed or moved, so a handle stays valid for the life of the pool; equal
+// strings intern to the same handle, so comparing handles is comparing
+// pointers. Interning is thread-safe (sharded by hash, like
+// ShardedSharedMutex); reading a handle takes no lock.
+class StringPool {
+public:
+    class Handle {
+    private:
+        const char* entry;  // uint32 length followed by the bytes; nullptr for ""
+
+        explicit Handle(const char* entry) : entry(entry) {}
+        friend class StringPool;
+
+    public:
+        Handle() : entry(nullptr) {}
+
+        std::string_view view() const {
+            if (!entry) return std::string_view();
+            std::uint32_t length;
+            std::memcpy(&length, entry, sizeof(length));
+            return std::string_view(entry + sizeof(length), length);
+        }
+        bool operator==(Handle other) const { return entry == other.entry; }
+        bool operator!=(Handle other) const { return entry != other.entry; }
+    };
+
+    // The pool Book fields are interned into
+    static StringPool& shared();
+
+    StringPool() = default;
+    StringPool(const StringPool&) = delete;
+    StringPool& operator=(const StringPool&) = delete;
+
+    Handle intern(std::string_view text);
+
+    std::size_t size() const;   // distinct strings
+    std::size_t bytes() const;  // arena bytes reserved
+
+private:
+    static const std::size_t SHARDS = 16;
+    static const std::size_t BLOCK_SIZE = 64 * 1024;
+
+    struct alignas(64) Shard {
+        mutable std::mutex mutex;
+        std::unordered_set<std::string_view> strings;  // views into blocks
+        std::vector<std::unique_ptr<char[]>> blocks;
+        std::size_t blockUsed = BLOCK_SIZE;  // bytes used in blocks.back()
+        std::size_t bytes = 0;
+    };
+    std::array<Shard, SHARDS> shards;
+
+    static const char* store(Shard& shard, std::string_view text);
+};
+
+#endif
@@ -0,0 +1,177 @@
+#include "synthetic_data.hpp"
+#include "book.hpp"
+#include "role_policy.hpp"
+#include "utils.hpp"
+#include <algorithm>
+#include <random>
+#include <sstream>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+const char* const WORDS[] = {
+    "Shadow", "River", "Garden", "Empire", "Silent", "Winter", "Golden", "Night",
+    "Ocean", "Secret", "Broken", "Crown", "Forest", "Lost", "Iron", "Glass",
+    "Storm", "Hidden", "Last", "Paper", "Stone", "Burning", "Distant", "Wild",
+    "Journey", "Memory", "Letters", "Kingdom", "Light", "House", "Island", "City",
+};
+const std::size_t WORD_COUNT = sizeof(WORDS) / sizeof(WORDS[0]);
+const std::time_t DAY = 24 * 60 * 60;
+
+// Prefix plus seven base-36 digits, the shape of IDs in existing data files
+std::string makeId(char prefix, std::size_t index) {
+    const char digits[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    std::string id(8, '0');
+    id[0] = prefix;
+    for (int i = 7; i > 0 && index > 0; --i) {
+        id[i] = digits[index % 36];
+        index /= 36;
+    }
+    return id;
+}
+}
+
+Id SyntheticData::bookId(std::size_t index) {
+    return Id::fromString(makeId('B', index));
+}
+
+Id SyntheticData::userId(std::size_t index) {
+    return Id::fromString(makeId('U', index));
+}
+
+std::string SyntheticData::userEmail(std::size_t index) {
+    return "patron" + std::to_string(index) + "@example.com";
+}
+
+std::string SyntheticData::userPassword(std::size_t index) {
+    return "pw" + std::to_string(index);
+}
+
+// Mostly students, some faculty, a few librarians
+UserRole SyntheticData::userRole(std::size_t index) {
+    std::size_t bucket = (index * 37) % 100;
+    return bucket < 80 ? UserRole::STUDENT : bucket < 97 ? UserRole::FACULTY : UserRole::LIBRARIAN;
+}
+
+namespace {
+std::size_t openLoansOf(std::size_t index, const SyntheticData::Config& config) {
+    if (config.openLoans <= 0 || !SyntheticData::holdsLoans(index)) return 0;
+    int limit = RolePolicies::of(SyntheticData::userRole(index)).maxBooks;
+    return static_cast<std::size_t>(std::min(config.openLoans, limit));
+}
+}
+
+std::size_t SyntheticData::loanedBooks(const Config& config) {
+    std::size_t loaned = 0;
+    for (std::size_t i = 0; i < config.users; ++i) loaned += openLoansOf(i, config);
+    return std::min(loaned, config.books);
+}
+
+void SyntheticData::write(const std::string& dataDir, const Config& config) {
+    std::mt19937 rng(config.seed);
+    std::size_t firstLoaned = config.books - loanedBooks(config);
+
+    std::ostringstream books;
+    for (std::size_t i = 0; i < config.books; ++i) {
+        books << bookId(i) << "|The " << WORDS[rng() % WORD_COUNT] << " "
+              << WORDS[rng() % WORD_COUNT] << " " << WORDS[rng() % WORD_COUNT]
+              << "|Author " << (rng() % 5000) << "|Publisher " << (rng() % 50)
+              << "|" << (1800 + rng() % 225) << "|978-" << (1000000000 + i) << "|"
+              << static_cast<int>(i < firstLoaned ? BookStatus::AVAILABLE : BookStatus::BORROWED)
+              << "\n";
+    }
+    Utils::saveToFile(dataDir + "/books.txt", books.str());
+
+    // Histories are closed loans stepping back from EPOCH, some returned
+    // late, then the open loans (own generator, so the rest stays the same)
+    std::mt19937 loanRng(config.seed + 2);
+    std::size_t nextLoaned = firstLoaned;
+    std::ostringstream users;
+    for (std::size_t i = 0; i < config.users; ++i) {
+        const RolePolicy& policy = RolePolicies::of(userRole(i));
+        std::size_t open = std::min(openLoansOf(i, config), config.books - nextLoaned);
+        std::vector<std::pair<std::size_t, std::time_t>> loans;
+        double fine = 0.0;
+        for (std::size_t l = 0; l < open; ++l) {
+            std::time_t borrowDate;
+            if (static_cast<int>(loanRng() % 100) < config.overduePct) {
+                int daysOverdue = 1 + static_cast<int>(loanRng() % 30);
+                borrowDate = config.now - (policy.loanDays + daysOverdue) * DAY;
+                fine += policy.fine(daysOverdue);
+            } else {
+                borrowDate = config.now - static_cast<std::time_t>(
+                    loanRng() % static_cast<unsigned>(std::max(1, policy.loanDays))) * DAY;
+            }
+            loans.emplace_back(nextLoaned++, borrowDate);
+        }
+
+        users << static_cast<int>(userRole(i)) << "|" << userId(i) << "|Patron " << i << "|" << userEmail(i)
+              << "|" << userPassword(i) << "|" << fine << ";" << loans.size() << ";";
+        for (const auto& loan : loans) users << bookId(loan.first) << ",";
+        users << ";" << config.history + loans.size() << ";";
+        std::time_t borrowDate = EPOCH;
+        for (int h = 0; h < config.history; ++h) {
+            borrowDate -= (10 + rng() % 30) * DAY;
+            std::time_t returnDate = borrowDate + (1 + rng() % 40) * DAY;
+            users << bookId(config.books ? rng() % config.books : 0) << ","
+                  << borrowDate << "," << returnDate << ";";
+        }
+        for (const auto& loan : loans) users << bookId(loan.first) << "," << loan.second << ",0;";
+        users << "\n";
+    }
+    Utils::saveToFile(dataDir + "/users.txt", users.str());
+}
+
+void SyntheticData::writeTransactions(const std::string& path, const Config& config,
+                                      std::size_t events) {
+    struct Loan {
+        std::size_t user;
+        std::size_t book;
+        std::time_t borrowDate;
+    };
+    std::mt19937 rng(config.seed + 1);
+    std::vector<Loan> open;
+    std::unordered_set<std::size_t> onLoan;
+    std::vector<int> userLoans(config.users, 0);
+
+    std::ostringstream log;
+    log << "# Format: BookID|UserID|BorrowDate|ReturnDate|Fine\n";
+    std::time_t now = EPOCH;
+    std::size_t written = 0;
+    int attempts = 0;
+    while (written < events && config.users > 0 && config.books > 0) {
+        now += 1 + rng() % 120;
+
+        // Return an open loan about as often as a new one starts, once
+        // there are enough out
+        if (!open.empty() && (rng() % 2 == 0 || attempts > 100)) {
+            std::size_t pick = rng() % open.size();
+            Loan loan = open[pick];
+            open[pick] = open.back();
+            open.pop_back();
+            onLoan.erase(loan.book);
+            --userLoans[loan.user];
+            log << bookId(loan.book) << "|" << userId(loan.user) << "|" << loan.borrowDate
+                << "|" << now << "|0\n";
+            ++written;
+            attempts = 0;
+            continue;
+        }
+
+        std::size_t user = rng() % config.users;
+        std::size_t book = rng() % config.books;
+        int limit = userRole(user) == UserRole::STUDENT ? 3 :
+                    userRole(user) == UserRole::FACULTY ? 5 : 0;
+        if (userLoans[user] >= limit || onLoan.count(book)) {
+            if (++attempts > 100000) break;  // nobody left who can borrow
+            continue;
+        }
+        attempts = 0;
+        onLoan.insert(book);
+        ++userLoans[user];
+        open.push_back({user, book, now});
+        log << bookId(book) << "|" << userId(user) << "|" << now << "|0|0.0\n";
+        ++written;
+    }
+    Utils::saveToFile(path, log.str());
+}
@@ -0,0 +1,50 @@
+#ifndef SYNTHETIC_DATA_HPP
+#define SYNTHETIC_DATA_HPP
+
+#include <cstddef>
+#include <ctime>
+#include <string>
+#include "user.hpp"
+
+// Generates books.txt/users.txt of any size for the benchmark tools.
+// Output is deterministic for a given config, and IDs, emails and
+// passwords can be recomputed from an index, so a tool can address
+// records without reading the files back.
+class SyntheticData {
+public:
+    struct Config {
+        std::size_t books = 100000;
+        std::size_t users = 20000;
+        int history = 20;        // closed loans per user
+        unsigned seed = 42;
+        // Users with an odd index hold this many open loans (up to their
+        // role's limit) on the last books of the catalogue; overduePct of
+        // them are past due at `now`, and a user with overdue loans owes
+        // their fines
+        int openLoans = 0;
+        int overduePct = 0;
+        std::time_t now = EPOCH;
+    };
+
+    // Fixed "now" the histories are laid out against
+    static constexpr std::time_t EPOCH = 1700000000;
+
+    static Id bookId(std::size_t index);
+    static Id userId(std::size_t index);
+    static std::string userEmail(std::size_t index);
+    static std::string userPassword(std::size_t index);
+    static UserRole userRole(std::size_t index);
+    static bool holdsLoans(std::size_t index) { return index % 2 == 1; }
+    // Books [books - loanedBooks, books) are out on the open loans
+    static std::size_t loanedBooks(const Config& config);
+
+    // Write books.txt and users.txt into dataDir (which must exist)
+    static void write(const std::string& dataDir, const Config& config);
+
+    // Write a transactions log of `events` borrows and returns by the
+    // users of `config`, in time order and in the format Library logs
+    static void writeTransactions(const std::string& path, const Config& config,
+                                  std::size_t events);
+};
+
+#endif
@@ -0,0 +1,225 @@
+#include "transaction_logger.hpp"
+#include "transaction_segments.hpp"
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+
+namespace {
+long dayOf(std::time_t time) {
+    return static_cast<long>(time / (24 * 60 * 60));
+}
+
+bool writeAll(int fd, const char* data, std::size_t size) {
+    std::size_t written = 0;
+    while (written < size) {
+        ssize_t n = ::write(fd, data + written, size - written);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        written += static_cast<std::size_t>(n);
+    }
+    return true;
+}
+}
+
+TransactionLogger::TransactionLogger(const std::string& path, std::size_t capacity)
+    : path(path)
+    , fd(-1)
+    , fileBytes(0)
+    , fileDay(0)
+    , nextSegment(1)
+    , ring(capacity > 0 ? capacity : 1)
+    , head(0)
+    , count(0)
+    , inFlight(0)
+    , flushRequested(false)
+    , stopping(false) {}
+
+TransactionLogger::~TransactionLogger() {
+    close();
+}
+
+bool TransactionLogger::open() {
+    if (fd >= 0) return true;
+
+    fd = openActive();
+    if (fd < 0) {
+        std::cout << "Error: Cannot open transaction log " << path << "\n";
+        return false;
+    }
+    nextSegment = TransactionSegments::nextNumber(path);
+    stopping = false;
+    writer = std::thread(&TransactionLogger::writerLoop, this);
+    return true;
+}
+
+void TransactionLogger::close() {
+    if (fd < 0) return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    notEmpty.notify_one();
+    writer.join();  // the writer drains the ring before it exits
+    ::close(fd);
+    fd = -1;
+}
+
+void TransactionLogger::setPolicy(const FlushPolicy& newPolicy) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        policy = newPolicy;
+    }
+    notEmpty.notify_one();
+}
+
+void TransactionLogger::setRotation(const RotationPolicy& newRotation) {
+    std::lock_guard<std::mutex> lock(mutex);
+    rotation = newRotation;
+}
+
+int TransactionLogger::openActive() {
+    int file = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (file < 0) return -1;
+
+    struct stat st;
+    if (::fstat(file, &st) != 0) {
+        ::close(file);
+        return -1;
+    }
+    fileBytes = static_cast<std::uint64_t>(st.st_size);
+    fileDay = dayOf(fileBytes > 0 ? st.st_mtime : std::time(nullptr));
+    if (fileBytes == 0) {
+        std::string header = std::string(TransactionSegments::HEADER) + "\n";
+        if (writeAll(file, header.data(), header.size())) fileBytes = header.size();
+    }
+    return file;
+}
+
+void TransactionLogger::rotateIfDue(std::size_t incoming, const RotationPolicy& when) {
+    long today = dayOf(std::time(nullptr));
+    bool hasRecords = fileBytes > std::strlen(TransactionSegments::HEADER) + 1;
+    bool due = hasRecords && ((when.daily && fileDay != today) ||
+                              (when.maxBytes > 0 && fileBytes + incoming > when.maxBytes));
+    if (!due) return;
+
+    // Everything queued before this batch is already on disk
+    if (!TransactionSegments::seal(path, nextSegment)) {
+        std::cout << "Error: Cannot rotate transaction log " << path << "\n";
+        fileBytes = 0;  // retry once the cap or the day comes round again
+        fileDay = today;
+        return;
+    }
+    ++nextSegment;
+    int next = openActive();
+    if (next < 0) {
+        // Keep appending to the sealed file; its index will be rebuilt
+        std::cout << "Error: Cannot open transaction log " << path << "\n";
+        fileBytes = 0;
+        fileDay = today;
+        return;
+    }
+    int sealed;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        sealed = fd;
+        fd = next;
+    }
+    ::close(sealed);
+}
+
+void TransactionLogger::log(const std::string& record) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (fd < 0) return;
+
+    notFull.wait(lock, [this] { return count < ring.size(); });
+    ring[(head + count) % ring.size()].assign(record);  // reuses slot capacity
+    ++count;
+    if (shouldDrain()) {
+        notEmpty.notify_one();
+    }
+}
+
+void TransactionLogger::flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (fd < 0) return;
+
+    flushRequested = true;
+    notEmpty.notify_one();
+    drained.wait(lock, [this] { return (count == 0 && inFlight == 0) || fd < 0; });
+}
+
+bool TransactionLogger::shouldDrain() const {
+    if (count == 0) return false;
+    if (stopping || flushRequested || count == ring.size()) return true;
+
+    switch (policy.mode) {
+        case FlushPolicy::Mode::EVERY_RECORD: return true;
+        case FlushPolicy::Mode::BATCH: return count >= policy.batchRecords;
+        case FlushPolicy::Mode::INTERVAL: return false;  // woken by the timer
+    }
+    return false;
+}
+
+void TransactionLogger::writerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    std::string batch;
+
+    while (true) {
+        if (policy.mode == FlushPolicy::Mode::INTERVAL && !stopping) {
+            notEmpty.wait_for(lock, std::chrono::milliseconds(policy.intervalMs),
+                [this] { return stopping || flushRequested || count == ring.size(); });
+        } else {
+            notEmpty.wait(lock, [this] { return stopping || shouldDrain(); });
+        }
+
+        if (count == 0) {
+            flushRequested = false;
+            drained.notify_all();
+            if (stopping) break;
+            continue;
+        }
+
+        // Take everything queued in one pass; log() may refill meanwhile
+        batch.clear();
+        for (std::size_t i = 0; i < count; ++i) {
+            batch += ring[(head + i) % ring.size()];
+            batch += '\n';
+        }
+        inFlight = count;
+        head = (head + count) % ring.size();
+        count = 0;
+        notFull.notify_all();
+        bool sync = policy.fsync;
+        RotationPolicy when = rotation;
+        lock.unlock();
+
+        rotateIfDue(batch.size(), when);
+        writeBatch(batch, sync);
+
+        lock.lock();
+        inFlight = 0;
+        if (count == 0) {
+            flushRequested = false;
+            drained.notify_all();
+        }
+    }
+}
+
+void TransactionLogger::writeBatch(const std::string& batch, bool sync) {
+    if (!writeAll(fd, batch.data(), batch.size())) {
+        std::cout << "Error: Transaction log write failed\n";
+        return;
+    }
+    fileBytes += batch.size();
+    if (sync) {
+        ::fdatasync(fd);
+    }
+}
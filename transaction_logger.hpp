@@ -0,0 +1,89 @@
+#ifndef TRANSACTION_LOGGER_HPP
+#define TRANSACTION_LOGGER_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// When the background writer drains the ring buffer to disk
+struct FlushPolicy {
+    enum class Mode {
+        EVERY_RECORD,  // write as soon as a record arrives
+        INTERVAL,      // write every intervalMs milliseconds
+        BATCH          // write once batchRecords records are queued
+    };
+
+    Mode mode = Mode::INTERVAL;
+    int intervalMs = 100;
+    std::size_t batchRecords = 64;
+    bool fsync = false;  // fdatasync after every write
+};
+
+// When the active log file is sealed into a numbered segment (see
+// TransactionSegments) and a fresh one started
+struct RotationPolicy {
+    bool daily = true;                    // at the first write of a new UTC day
+    std::size_t maxBytes = 64 << 20;      // before a write would pass this; 0 for no cap
+};
+
+// Keeps the transaction file open and hands records to a background thread
+// through a fixed-size ring buffer, so borrow/return never wait on open(),
+// close() or the disk. Everything queued is written before the logger is
+// closed or destroyed. The writer also seals the file into a numbered
+// segment and starts a new one as the RotationPolicy asks.
+class TransactionLogger {
+private:
+    std::string path;
+    int fd;
+    FlushPolicy policy;
+    RotationPolicy rotation;
+
+    // Active file; only the writer thread touches these once it runs
+    std::uint64_t fileBytes;
+    long fileDay;       // UTC day of its first write
+    long nextSegment;
+
+    std::vector<std::string> ring;
+    std::size_t head;     // next slot to drain
+    std::size_t count;    // queued records
+    std::size_t inFlight; // records taken by the writer but not yet written
+    bool flushRequested;
+    bool stopping;
+
+    std::mutex mutex;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+    std::condition_variable drained;
+    std::thread writer;
+
+    bool shouldDrain() const;
+    void writerLoop();
+    void writeBatch(const std::string& batch, bool sync);
+    int openActive();  // sets fileBytes/fileDay; -1 on failure
+    void rotateIfDue(std::size_t incoming, const RotationPolicy& when);
+
+public:
+    explicit TransactionLogger(const std::string& path, std::size_t capacity = 4096);
+    ~TransactionLogger();
+
+    TransactionLogger(const TransactionLogger&) = delete;
+    TransactionLogger& operator=(const TransactionLogger&) = delete;
+
+    bool open();
+    void close();
+    bool isOpen() const { return fd >= 0; }
+
+    void setPolicy(const FlushPolicy& newPolicy);
+    void setRotation(const RotationPolicy& newRotation);
+
+    // Queue one line (without newline); blocks only when the ring is full
+    void log(const std::string& record);
+    // Block until everything queued so far has been written
+    void flush();
+};
+
+#endif
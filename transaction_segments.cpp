@@ -0,0 +1,486 @@
+#include "transaction_segments.hpp"
+#include "record_parser.hpp"
+#include "utils.hpp"
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <limits>
+#include <sstream>
+
+const char* const TransactionSegments::HEADER = "# Format: BookID|UserID|BorrowDate|ReturnDate|Fine";
+
+namespace {
+const char* const TXT = ".txt";
+const char* const IDX = ".idx";
+
+// Read-only mapping of a whole file; an empty file maps to an empty view
+class MappedFile {
+private:
+    void* mapping = nullptr;
+    std::size_t size = 0;
+
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() {
+        if (mapping) ::munmap(mapping, size);
+    }
+
+    bool open(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            return false;
+        }
+        size = static_cast<std::size_t>(st.st_size);
+        if (size > 0) {
+            mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping == MAP_FAILED) mapping = nullptr;
+        }
+        ::close(fd);
+        return size == 0 || mapping;
+    }
+
+    std::string_view text() const {
+        return mapping ? std::string_view(static_cast<const char*>(mapping), size) : std::string_view();
+    }
+};
+
+bool endsWith(const std::string& text, const char* suffix) {
+    std::size_t length = std::char_traits<char>::length(suffix);
+    return text.size() >= length && text.compare(text.size() - length, length, suffix) == 0;
+}
+
+std::string stemOf(const std::string& path) {
+    return endsWith(path, TXT) ? path.substr(0, path.size() - 4) : path;
+}
+
+// Parse every record of text, calling visit(record, offset of its line)
+template <typename Visit>
+void forEachRecord(std::string_view text, Visit visit) {
+    LineReader lines(text);
+    std::string_view line;
+    TransactionRecord record;
+    while (lines.next(line)) {
+        if (TransactionRecord::parse(line, record)) {
+            visit(record, static_cast<std::uint64_t>(line.data() - text.data()));
+        }
+    }
+}
+
+// Index of a sealed segment, rebuilt from its text and saved when the
+// stored one is missing or stale
+void indexFor(const TransactionSegments::Segment& segment, std::string_view text,
+              SegmentIndex& index, bool withBooks = true) {
+    std::string path = TransactionSegments::indexPath(segment.path);
+    if (index.load(path, withBooks) && index.segmentBytes == text.size()) return;
+    index.build(text);
+    index.save(path);
+}
+
+// Map each log file in turn and hand it to visit. False if one vanished
+// meanwhile (rotated or compacted); the caller starts over.
+bool visitSegments(const std::string& activePath,
+                   const std::function<void(const TransactionSegments::Segment&,
+                                            std::string_view)>& visit) {
+    for (const auto& segment : TransactionSegments::list(activePath)) {
+        MappedFile file;
+        if (!file.open(segment.path)) return false;
+        visit(segment, file.text());
+    }
+    return true;
+}
+
+std::vector<TransactionRecord> collect(
+    const std::string& activePath,
+    const std::function<void(const TransactionSegments::Segment&, std::string_view,
+                             std::vector<TransactionRecord>&)>& read) {
+    std::vector<TransactionRecord> records;
+    for (int attempt = 0; attempt < 3; ++attempt) {
+        records.clear();
+        bool complete = visitSegments(activePath, [&](const TransactionSegments::Segment& segment,
+                                                      std::string_view text) {
+            read(segment, text, records);
+        });
+        if (complete) break;
+    }
+    std::stable_sort(records.begin(), records.end(),
+                     [](const TransactionRecord& a, const TransactionRecord& b) {
+                         return a.time() < b.time();
+                     });
+    return records;
+}
+
+long monthOf(std::time_t time) {
+    std::tm utc;
+    gmtime_r(&time, &utc);
+    return utc.tm_year * 12L + utc.tm_mon;
+}
+}
+
+bool TransactionRecord::parse(std::string_view line, TransactionRecord& record) {
+    if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+    if (line.empty() || line.front() == '#') return false;
+
+    FieldReader reader(line);
+    std::string_view bookField, userField, borrowField, returnField, fineField;
+    long long borrowDate = 0, returnDate = 0;
+    if (!reader.next('|', bookField) || !Id::parse(bookField, record.bookId) ||
+        !reader.next('|', userField) || !Id::parse(userField, record.userId) ||
+        !reader.next('|', borrowField) || !parseNumber(borrowField, borrowDate) ||
+        !reader.next('|', returnField) || !parseNumber(returnField, returnDate) ||
+        !reader.next('|', fineField) || !parseNumber(fineField, record.fine) || !reader.atEnd()) {
+        return false;
+    }
+    record.borrowDate = static_cast<std::time_t>(borrowDate);
+    record.returnDate = static_cast<std::time_t>(returnDate);
+    return true;
+}
+
+void SegmentIndex::build(std::string_view text) {
+    segmentBytes = text.size();
+    records = 0;
+    earliest = std::numeric_limits<std::time_t>::max();
+    latest = std::numeric_limits<std::time_t>::min();
+    marks.assign(1, Mark{0, latest, 0});
+    bookBlocks.clear();
+
+    std::vector<std::time_t> blockEarliest(1, earliest);
+    forEachRecord(text, [&](const TransactionRecord& record, std::uint64_t offset) {
+        if (records > 0 && records % MARK_INTERVAL == 0) {
+            marks.push_back({offset, latest, 0});
+            blockEarliest.push_back(std::numeric_limits<std::time_t>::max());
+        }
+        std::uint32_t block = static_cast<std::uint32_t>(marks.size() - 1);
+        std::time_t time = record.time();
+        earliest = std::min(earliest, time);
+        latest = std::max(latest, time);
+        blockEarliest.back() = std::min(blockEarliest.back(), time);
+        auto& blocks = bookBlocks[record.bookId];
+        if (blocks.empty() || blocks.back() != block) blocks.push_back(block);
+        ++records;
+    });
+
+    // Oldest event from each mark to the end
+    std::time_t after = std::numeric_limits<std::time_t>::max();
+    for (std::size_t i = marks.size(); i-- > 0;) {
+        after = std::min(after, blockEarliest[i]);
+        marks[i].earliestFrom = after;
+    }
+    if (records == 0) earliest = latest = 0;
+}
+
+bool SegmentIndex::load(const std::string& path, bool withBooks) {
+    MappedFile file;
+    if (!file.open(path)) return false;
+
+    marks.clear();
+    bookBlocks.clear();
+    bool sawSummary = false;
+    LineReader lines(file.text());
+    std::string_view line;
+    while (lines.next(line)) {
+        if (line.empty() || line.front() == '#') continue;
+        FieldReader reader(line);
+        std::string_view kind, first, second, third, fourth;
+        if (!reader.next('|', kind)) return false;
+        if (kind == "S") {
+            long long from = 0, to = 0;
+            if (!reader.next('|', first) || !parseNumber(first, segmentBytes) ||
+                !reader.next('|', second) || !parseNumber(second, records) ||
+                !reader.next('|', third) || !parseNumber(third, from) ||
+                !reader.next('|', fourth) || !parseNumber(fourth, to) || !reader.atEnd()) {
+                return false;
+            }
+            earliest = static_cast<std::time_t>(from);
+            latest = static_cast<std::time_t>(to);
+            sawSummary = true;
+        } else if (kind == "M") {
+            Mark mark;
+            long long before = 0, from = 0;
+            if (!reader.next('|', first) || !parseNumber(first, mark.offset) ||
+                !reader.next('|', second) || !parseNumber(second, before) ||
+                !reader.next('|', third) || !parseNumber(third, from) || !reader.atEnd()) {
+                return false;
+            }
+            mark.latestBefore = static_cast<std::time_t>(before);
+            mark.earliestFrom = static_cast<std::time_t>(from);
+            marks.push_back(mark);
+        } else if (kind == "B") {
+            if (!withBooks) break;  // book lines come last
+            Id bookId;
+            if (!reader.next('|', first) || !Id::parse(first, bookId)) return false;
+            auto& blocks = bookBlocks[bookId];
+            FieldReader list(reader.rest());
+            std::string_view item;
+            while (!list.atEnd() && list.next(',', item)) {
+                std::uint32_t block = 0;
+                if (!parseNumber(item, block)) return false;
+                blocks.push_back(block);
+            }
+        } else {
+            return false;
+        }
+    }
+    if (!sawSummary || marks.empty() || marks.front().offset != 0) return false;
+    for (const auto& entry : bookBlocks) {
+        for (std::uint32_t block : entry.second) {
+            if (block >= marks.size()) return false;
+        }
+    }
+    return true;
+}
+
+void SegmentIndex::save(const std::string& path) const {
+    std::ostringstream out;
+    out << "# S|bytes|records|earliest|latest, M|offset|latestBefore|earliestFrom, "
+           "B|bookId|block,block,...\n";
+    out << "S|" << segmentBytes << "|" << records << "|" << earliest << "|" << latest << "\n";
+    for (const Mark& mark : marks) {
+        out << "M|" << mark.offset << "|" << mark.latestBefore << "|" << mark.earliestFrom << "\n";
+    }
+    for (const auto& entry : bookBlocks) {
+        out << "B|" << entry.first << "|";
+        for (std::uint32_t block : entry.second) out << block << ",";
+        out << "\n";
+    }
+    Utils::saveToFile(path, out.str());
+}
+
+std::pair<std::uint64_t, std::uint64_t> SegmentIndex::range(std::time_t from,
+                                                            std::time_t to) const {
+    // Both bounds only move forward through the marks
+    std::uint64_t begin = 0, end = segmentBytes;
+    for (std::size_t i = 1; i < marks.size() && marks[i].latestBefore < from; ++i) {
+        begin = marks[i].offset;
+    }
+    for (const Mark& mark : marks) {
+        if (mark.earliestFrom >= to) {
+            end = mark.offset;
+            break;
+        }
+    }
+    return {begin, std::max(begin, end)};
+}
+
+std::pair<std::uint64_t, std::uint64_t> SegmentIndex::block(std::uint32_t block) const {
+    return {marks[block].offset, block + 1 < marks.size() ? marks[block + 1].offset : segmentBytes};
+}
+
+std::string TransactionSegments::segmentPath(const std::string& activePath, long number) {
+    return stemOf(activePath) + "." + std::to_string(number) + TXT;
+}
+
+std::string TransactionSegments::segmentPath(const std::string& activePath, long first,
+                                             long last) {
+    return stemOf(activePath) + "." + std::to_string(first) + "-" + std::to_string(last) + TXT;
+}
+
+std::string TransactionSegments::indexPath(const std::string& segmentPath) {
+    return stemOf(segmentPath) + IDX;
+}
+
+std::vector<TransactionSegments::Segment> TransactionSegments::list(const std::string& activePath) {
+    return list(activePath, nullptr);
+}
+
+std::vector<TransactionSegments::Segment> TransactionSegments::list(const std::string& activePath,
+                                                                    std::vector<Segment>* covered) {
+    std::string::size_type slash = activePath.rfind('/');
+    std::string dir = slash == std::string::npos ? "." : activePath.substr(0, slash);
+    std::string prefix = stemOf(activePath.substr(slash == std::string::npos ? 0 : slash + 1)) + ".";
+
+    std::vector<Segment> segments;
+    if (DIR* handle = ::opendir(dir.c_str())) {
+        while (dirent* entry = ::readdir(handle)) {
+            std::string name = entry->d_name;
+            if (name.size() <= prefix.size() + 4 || name.compare(0, prefix.size(), prefix) != 0 ||
+                !endsWith(name, TXT)) {
+                continue;
+            }
+            // "<N>" or, for a merged segment, "<first>-<last>"
+            std::string_view numbers = std::string_view(name).substr(
+                prefix.size(), name.size() - prefix.size() - 4);
+            std::size_t dash = numbers.find('-', 1);
+            long number = -1, last = -1;
+            if (!parseNumber(numbers.substr(0, dash), number) || number < 0) continue;
+            if (dash == std::string_view::npos) {
+                last = number;
+            } else if (!parseNumber(numbers.substr(dash + 1), last) || last < number) {
+                continue;
+            }
+            segments.push_back({number, dir + "/" + name, last});
+        }
+        ::closedir(handle);
+    }
+    // Widest first among equal starts, so a covering segment precedes what
+    // it covers and one pass drops the rest
+    std::sort(segments.begin(), segments.end(), [](const Segment& a, const Segment& b) {
+        return a.number != b.number ? a.number < b.number : a.last > b.last;
+    });
+    std::vector<Segment> visible;
+    for (Segment& segment : segments) {
+        if (!visible.empty() && segment.last <= visible.back().last) {
+            if (covered) covered->push_back(std::move(segment));
+            continue;
+        }
+        visible.push_back(std::move(segment));
+    }
+    segments.swap(visible);
+
+    struct stat st;
+    if (::stat(activePath.c_str(), &st) == 0) segments.push_back({-1, activePath});
+    return segments;
+}
+
+long TransactionSegments::nextNumber(const std::string& activePath) {
+    long next = 1;
+    for (const auto& segment : list(activePath)) next = std::max(next, segment.last + 1);
+    return next;
+}
+
+bool TransactionSegments::seal(const std::string& activePath, long number) {
+    std::string sealed = segmentPath(activePath, number);
+    if (std::rename(activePath.c_str(), sealed.c_str()) != 0) return false;
+
+    MappedFile file;
+    if (file.open(sealed)) {
+        SegmentIndex index;
+        index.build(file.text());
+        index.save(indexPath(sealed));
+    }
+    return true;
+}
+
+std::vector<TransactionRecord> TransactionSegments::bookHistory(const std::string& activePath,
+                                                                Id bookId) {
+    return collect(activePath, [bookId](const Segment& segment, std::string_view text,
+                                        std::vector<TransactionRecord>& records) {
+        auto keep = [&](const TransactionRecord& record, std::uint64_t) {
+            if (record.bookId == bookId) records.push_back(record);
+        };
+        if (segment.number < 0) {
+            forEachRecord(text, keep);  // the active file has no index yet
+            return;
+        }
+        SegmentIndex index;
+        indexFor(segment, text, index);
+        auto blocks = index.bookBlocks.find(bookId);
+        if (blocks == index.bookBlocks.end()) return;
+        for (std::uint32_t block : blocks->second) {
+            auto bytes = index.block(block);
+            forEachRecord(text.substr(bytes.first, bytes.second - bytes.first), keep);
+        }
+    });
+}
+
+std::vector<TransactionRecord> TransactionSegments::between(const std::string& activePath,
+                                                            std::time_t from, std::time_t to) {
+    return collect(activePath, [from, to](const Segment& segment, std::string_view text,
+                                          std::vector<TransactionRecord>& records) {
+        auto keep = [&](const TransactionRecord& record, std::uint64_t) {
+            if (record.time() >= from && record.time() < to) records.push_back(record);
+        };
+        if (segment.number < 0) {
+            forEachRecord(text, keep);
+            return;
+        }
+        SegmentIndex index;
+        indexFor(segment, text, index, false);
+        if (index.records == 0 || index.latest < from || index.earliest >= to) return;
+        auto bytes = index.range(from, to);
+        forEachRecord(text.substr(bytes.first, bytes.second - bytes.first), keep);
+    });
+}
+
+std::size_t TransactionSegments::compact(const std::string& activePath, std::time_t before) {
+    struct Group {
+        long month;
+        std::vector<Segment> segments;
+    };
+    // Originals a crash left behind after an earlier merge
+    std::vector<Segment> covered;
+    std::vector<Segment> segments = list(activePath, &covered);
+    std::size_t removed = 0;
+    for (const Segment& segment : covered) {
+        std::remove(segment.path.c_str());
+        std::remove(indexPath(segment.path).c_str());
+        ++removed;
+    }
+
+    std::vector<Group> groups;
+    bool extend = false;  // the previous segment was old enough to merge
+    for (const auto& segment : segments) {
+        if (segment.number < 0) break;
+        MappedFile file;
+        if (!file.open(segment.path)) {
+            extend = false;
+            continue;
+        }
+        SegmentIndex index;
+        indexFor(segment, file.text(), index, false);
+        if (index.records > 0 && index.latest >= before) {
+            extend = false;
+            continue;
+        }
+        long month = index.records > 0 ? monthOf(index.earliest) : -1;
+        // Empty segments join whichever group they sit in
+        if (extend && (month < 0 || groups.back().month < 0 || groups.back().month == month)) {
+            if (groups.back().month < 0) groups.back().month = month;
+        } else {
+            groups.push_back({month, {}});
+        }
+        groups.back().segments.push_back(segment);
+        extend = true;
+    }
+
+    for (const Group& group : groups) {
+        if (group.segments.size() < 2) continue;
+
+        // Records stay in file order; headers and comments are dropped
+        std::string merged = std::string(HEADER) + "\n";
+        for (const Segment& segment : group.segments) {
+            MappedFile file;
+            if (!file.open(segment.path)) return removed;
+            LineReader lines(file.text());
+            std::string_view line;
+            while (lines.next(line)) {
+                if (line.empty() || line.front() == '#') continue;
+                merged.append(line.data(), line.size());
+                merged += '\n';
+            }
+        }
+
+        // The merged segment goes in under a new name that covers the
+        // group, so from the moment it is renamed into place list() hides
+        // the originals; removing them afterwards is only cleanup
+        std::string target = segmentPath(activePath, group.segments.front().number,
+                                         group.segments.back().last);
+        if (!Utils::saveToFile(target, merged)) return removed;
+        {
+            // Only drop the originals once the merged copy is in place
+            MappedFile written;
+            if (!written.open(target) || written.text() != merged) {
+                std::remove(target.c_str());
+                return removed;
+            }
+        }
+        SegmentIndex index;
+        index.build(merged);
+        index.save(indexPath(target));
+        for (const Segment& segment : group.segments) {
+            std::remove(segment.path.c_str());
+            std::remove(indexPath(segment.path).c_str());
+        }
+        removed += group.segments.size() - 1;
+    }
+    return removed;
+}
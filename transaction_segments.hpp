@@ -0,0 +1,111 @@
+#ifndef TRANSACTION_SEGMENTS_HPP
+#define TRANSACTION_SEGMENTS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "id.hpp"
+
+// One line of the transaction log: BookID|UserID|BorrowDate|ReturnDate|Fine.
+// Borrows have ReturnDate 0; returns carry the loan's borrow date.
+struct TransactionRecord {
+    Id bookId;
+    Id userId;
+    std::time_t borrowDate = 0;
+    std::time_t returnDate = 0;
+    double fine = 0.0;
+
+    bool isReturn() const { return returnDate != 0; }
+    // When the event happened
+    std::time_t time() const { return isReturn() ? returnDate : borrowDate; }
+
+    // False for comments, blank and malformed lines
+    static bool parse(std::string_view line, TransactionRecord& record);
+};
+
+// Sparse index of one sealed segment. Every MARK_INTERVAL records it notes
+// the byte offset together with the latest event time before it and the
+// earliest after it (records are only roughly in time order), and for each
+// book the blocks between marks holding its records. Stored next to the
+// segment as text; a size mismatch marks it stale.
+class SegmentIndex {
+public:
+    static const std::size_t MARK_INTERVAL = 256;
+
+    struct Mark {
+        std::uint64_t offset;
+        std::time_t latestBefore;  // newest event in [0, offset)
+        std::time_t earliestFrom;  // oldest event in [offset, end)
+    };
+
+    std::uint64_t segmentBytes = 0;
+    std::size_t records = 0;
+    std::time_t earliest = 0;
+    std::time_t latest = 0;
+    std::vector<Mark> marks;  // marks[0] is offset 0
+    std::unordered_map<Id, std::vector<std::uint32_t>> bookBlocks;
+
+    void build(std::string_view text);
+    // withBooks false skips bookBlocks, for time-range queries
+    bool load(const std::string& path, bool withBooks = true);
+    void save(const std::string& path) const;
+
+    // Byte range [begin, end) that holds every event in [from, to)
+    std::pair<std::uint64_t, std::uint64_t> range(std::time_t from, std::time_t to) const;
+    // Byte range of block `block`
+    std::pair<std::uint64_t, std::uint64_t> block(std::uint32_t block) const;
+};
+
+// The transaction log as an active file (transactions.txt) plus sealed
+// segments beside it (transactions.<N>.txt, N increasing with age order,
+// each with a transactions.<N>.idx). TransactionLogger seals the active
+// file when it rolls over; queries use the indexes to read only the
+// segments and blocks that can match, and compact() merges old segments
+// into transactions.<first>-<last>.txt. A merged segment hides every
+// segment whose numbers it covers, so a crash before the originals are
+// removed never counts a record twice.
+class TransactionSegments {
+public:
+    static const char* const HEADER;  // first line of every log file
+
+    struct Segment {
+        long number;       // -1 for the active file
+        std::string path;
+        long last = -1;    // last number a merged segment covers, else number
+    };
+
+    static std::string segmentPath(const std::string& activePath, long number);
+    static std::string segmentPath(const std::string& activePath, long first, long last);
+    static std::string indexPath(const std::string& segmentPath);
+
+    // Sealed segments oldest first (without any a merged one covers), then
+    // the active file if it exists
+    static std::vector<Segment> list(const std::string& activePath);
+    static long nextNumber(const std::string& activePath);
+
+    // Move the active file to segment `number` and index it
+    static bool seal(const std::string& activePath, long number);
+
+    // Every record of one book, oldest first
+    static std::vector<TransactionRecord> bookHistory(const std::string& activePath, Id bookId);
+    // Every event with from <= time < to, oldest first
+    static std::vector<TransactionRecord> between(const std::string& activePath,
+                                                  std::time_t from, std::time_t to);
+
+    // Merge the sealed segments holding nothing newer than `before` into
+    // one segment per calendar month (UTC), and delete covered segments a
+    // crash left behind. Returns how many files went.
+    // Not safe while queries read the same directory.
+    static std::size_t compact(const std::string& activePath, std::time_t before);
+
+private:
+    // list(), also handing back the segments a merged one covers
+    static std::vector<Segment> list(const std::string& activePath, std::vector<Segment>* covered);
+};
+
+#endif
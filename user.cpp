@@ -1,19 +1,42 @@
 #include "user.hpp"
+#include "library.hpp"
 #include "utils.hpp"
 #include <sstream>
+#include <stdexcept>
 #include <iostream>
 
 // Constructor implementation
-User::User(const std::string& name, const std::string& email, 
-           const std::string& password, UserRole role)
-    : id(Utils::generateUniqueId())
-    , name(name)
-    , email(email)
-    , password(password)
-    , role(role) {
-    std::cout << "Creating user: " << name << " (Role: " << 
-        (role == UserRole::STUDENT ? "Student" : 
-         role == UserRole::FACULTY ? "Faculty" : "Librarian") << ")\n";
+User::User(Id id, std::string name, std::string email,
+           std::string password, UserRole role)
+    : id(id)
+    , name(std::move(name))
+    , email(std::move(email))
+    , password(std::move(password))
+    , role(role)
+    , owner(nullptr) {}
+
+void User::applyUpdate(const std::function<void()>& change) {
+    if (owner) {
+        owner->updateUser(this, change);
+    } else {
+        change();
+    }
+}
+
+void User::updateName(const std::string& newName) {
+    applyUpdate([&] { name = newName; });
+}
+
+bool User::updateEmail(const std::string& newEmail) {
+    if (owner) {
+        return owner->updateUserEmail(this, newEmail);
+    }
+    email = newEmail;
+    return true;
+}
+
+void User::updatePassword(const std::string& newPassword) {
+    applyUpdate([&] { password = newPassword; });
 }
 
 std::string User::serialize() const {
@@ -24,104 +47,96 @@ std::string User::serialize() const {
 }
 
 User* User::deserialize(const std::string& data) {
-    std::stringstream ss(data);
-    std::string roleStr, id, name, email, password, accountData;
-
-    std::getline(ss, roleStr, '|');
-    std::getline(ss, id, '|');
-    std::getline(ss, name, '|');
-    std::getline(ss, email, '|');
-    std::getline(ss, password, '|');
-    std::getline(ss, accountData);
+    ParseError error;
+    std::unique_ptr<User> user = parse(data, error);
+    if (!user) {
+        throw std::invalid_argument("User::deserialize: " + error.describe());
+    }
+    return user.release();
+}
 
-    UserRole role = static_cast<UserRole>(std::stoi(roleStr));
-    User* user = nullptr;
+std::unique_ptr<User> User::parse(std::string_view data, ParseError& error) {
+    if (!data.empty() && data.back() == '\r') data.remove_suffix(1);
 
-    std::cout << "Deserializing user: " << name << " (Role: " << roleStr << ")\n";
+    FieldReader reader(data);
+    std::string_view roleStr, id, name, email, password;
+    int parsedRole = 0;
 
-    switch(role) {
-        case UserRole::STUDENT:
-            user = new Student(name, email, password);
-            break;
-        case UserRole::FACULTY:
-            user = new Faculty(name, email, password);
-            break;
-        case UserRole::LIBRARIAN:
-            user = new Librarian(name, email, password);
-            break;
+    if (!reader.next('|', roleStr) || !parseNumber(roleStr, parsedRole) ||
+        parsedRole < 0 || parsedRole > static_cast<int>(UserRole::LIBRARIAN)) {
+        parseFailure(error, "role", "expected 0, 1 or 2");
+        return nullptr;
+    }
+    Id parsedId;
+    if (!reader.next('|', id) || !Id::parse(id, parsedId)) {
+        parseFailure(error, "id", "expected 1-12 characters 0-9/A-Z");
+        return nullptr;
+    }
+    if (!reader.next('|', name)) {
+        parseFailure(error, "name", "missing");
+        return nullptr;
+    }
+    if (!reader.next('|', email)) {
+        parseFailure(error, "email", "missing");
+        return nullptr;
+    }
+    if (!reader.next('|', password)) {
+        parseFailure(error, "password", "missing");
+        return nullptr;
     }
 
-    if (user) {
-        user->id = id;
-        user->account = Account::deserialize(accountData);
+    Account account;
+    if (!Account::parse(reader.rest(), account, error)) {
+        return nullptr;
     }
 
+    std::unique_ptr<User> user(create(static_cast<UserRole>(parsedRole), parsedId,
+                                      std::string(name), std::string(email),
+                                      std::string(password)));
+    user->account = std::move(account);
     return user;
 }
 
-// Student implementation
-Student::Student(const std::string& name, const std::string& email, 
-                const std::string& password)
-    : User(name, email, password, UserRole::STUDENT) {}
-
-int Student::getMaxBooks() const { return 3; }
-int Student::getMaxDays() const { return 15; }
-double Student::calculateFine(int daysOverdue) const {
-    return daysOverdue > 0 ? daysOverdue * 10.0 : 0.0;
+User* User::create(UserRole role, std::string name,
+                   std::string email, std::string password) {
+    return create(role, Utils::generateUniqueId(), std::move(name),
+                  std::move(email), std::move(password));
 }
 
-bool Student::borrowBook(const std::string& bookId) {
-    if (getAccount().getCurrentlyBorrowedBooks().size() >= getMaxBooks()) {
-        std::cout << "Student has reached maximum books limit.\n";
-        return false;
-    }
-    if (getAccount().hasFine()) {
-        std::cout << "Student has unpaid fines.\n";
-        return false;
+User* User::create(UserRole role, Id id, std::string name,
+                   std::string email, std::string password) {
+    switch(role) {
+        case UserRole::STUDENT:
+            return new Student(id, std::move(name), std::move(email), std::move(password));
+        case UserRole::FACULTY:
+            return new Faculty(id, std::move(name), std::move(email), std::move(password));
+        case UserRole::LIBRARIAN:
+            return new Librarian(id, std::move(name), std::move(email), std::move(password));
     }
-    return getAccount().addBorrowedBook(bookId);
+    return nullptr;
 }
 
-bool Student::returnBook(const std::string& bookId) {
-    return getAccount().returnBook(bookId);
-}
-
-// Faculty implementation
-Faculty::Faculty(const std::string& name, const std::string& email, 
-                const std::string& password)
-    : User(name, email, password, UserRole::FACULTY) {}
-
-int Faculty::getMaxBooks() const { return 5; }
-int Faculty::getMaxDays() const { return 30; }
-double Faculty::calculateFine(int) const { return 0.0; }  // No fines for faculty
-
-bool Faculty::borrowBook(const std::string& bookId) {
-    if (getAccount().getCurrentlyBorrowedBooks().size() >= getMaxBooks()) {
-        std::cout << "Faculty has reached maximum books limit.\n";
-        return false;
-    }
-    return getAccount().addBorrowedBook(bookId);
-}
+// Role constructors; loan rules live in RolePolicies
+Student::Student(std::string name, std::string email,
+                 std::string password)
+    : Student(Utils::generateUniqueId(), std::move(name), std::move(email), std::move(password)) {}
 
-bool Faculty::returnBook(const std::string& bookId) {
-    return getAccount().returnBook(bookId);
-}
+Student::Student(Id id, std::string name, std::string email,
+                 std::string password)
+    : User(id, std::move(name), std::move(email), std::move(password), UserRole::STUDENT) {}
 
-// Librarian implementation
-Librarian::Librarian(const std::string& name, const std::string& email, 
-                     const std::string& password)
-    : User(name, email, password, UserRole::LIBRARIAN) {}
+Faculty::Faculty(std::string name, std::string email,
+                 std::string password)
+    : Faculty(Utils::generateUniqueId(), std::move(name), std::move(email), std::move(password)) {}
 
-int Librarian::getMaxBooks() const { return 0; }  // Cannot borrow books
-int Librarian::getMaxDays() const { return 0; }   // Cannot borrow books
-double Librarian::calculateFine(int) const { return 0.0; }
+Faculty::Faculty(Id id, std::string name, std::string email,
+                 std::string password)
+    : User(id, std::move(name), std::move(email), std::move(password), UserRole::FACULTY) {}
 
-bool Librarian::borrowBook(const std::string&) {
-    std::cout << "Librarians cannot borrow books.\n";
-    return false;
-}
+Librarian::Librarian(std::string name, std::string email,
+                     std::string password)
+    : Librarian(Utils::generateUniqueId(), std::move(name), std::move(email), std::move(password)) {}
 
-bool Librarian::returnBook(const std::string&) {
-    std::cout << "Librarians cannot return books.\n";
-    return false;
-}
\ No newline at end of file
+Librarian::Librarian(Id id, std::string name, std::string email,
+                     std::string password)
+    : User(id, std::move(name), std::move(email), std::move(password), UserRole::LIBRARIAN) {}
@@ -1,42 +1,49 @@
 #ifndef USER_HPP
 #define USER_HPP
 
+#include <functional>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <memory>
 #include <vector>
 #include <iostream>
 #include "account.hpp"
+#include "role_policy.hpp"
+#include "utils.hpp"
 
-// Encapsulation: Role types in enum class
-enum class UserRole {
-    STUDENT,
-    FACULTY,
-    LIBRARIAN
-};
+class Library;
 
-// Abstract base class for all users
+// Base class for all users; the subclasses only fix the role
 class User {
 private:  // Encapsulation: Private data members
-    std::string id;
+    Id id;
     std::string name;
     std::string email;
     std::string password;
     UserRole role;
     Account account;
+    Library* owner;  // Library whose index and journal must follow our updates
+    mutable std::mutex accountMutex;  // Serializes Library operations on account
+
+    // Run change under the owning Library's user lock (if any)
+    void applyUpdate(const std::function<void()>& change);
 
 protected:  // Protected constructor for abstract class
-    User(const std::string& name, const std::string& email, 
-         const std::string& password, UserRole role);
+    User(Id id, std::string name, std::string email,
+         std::string password, UserRole role);
 
 public:
     virtual ~User() = default;  // Virtual destructor for polymorphic behavior
 
     // Encapsulation: Getters
-    std::string getId() const { return id; }
-    std::string getName() const { return name; }
-    std::string getEmail() const { return email; }
-    std::string getPassword() const { return password; }
+    Id getId() const { return id; }
+    const std::string& getName() const { return name; }
+    const std::string& getEmail() const { return email; }
+    const std::string& getPassword() const { return password; }
     UserRole getRole() const { return role; }
     Account& getAccount() { return account; }
+    const Account& getAccount() const { return account; }
 
     // Authentication method
     bool authenticate(const std::string& inputPassword) const {
@@ -54,64 +61,75 @@ public:
     }
 
     // Update methods for attributes
-    void updateName(const std::string& newName) { name = newName; }
-    void updateEmail(const std::string& newEmail) { email = newEmail; }
-    void updatePassword(const std::string& newPassword) { password = newPassword; }
-
-    // Pure virtual methods define the interface
-    virtual int getMaxBooks() const = 0;
-    virtual int getMaxDays() const = 0;
-    virtual double calculateFine(int daysOverdue) const = 0;
-    virtual bool borrowBook(const std::string& bookId) = 0;
-    virtual bool returnBook(const std::string& bookId) = 0;
+    void updateName(const std::string& newName);
+    bool updateEmail(const std::string& newEmail);  // false if the email is taken
+    void updatePassword(const std::string& newPassword);
+
+    // Loan rules are the role's row of RolePolicies: a table lookup,
+    // no virtual call
+    const RolePolicy& getPolicy() const { return RolePolicies::of(role); }
+    int getMaxBooks() const { return getPolicy().maxBooks; }
+    int getMaxDays() const { return getPolicy().loanDays; }
+    double calculateFine(int daysOverdue) const { return getPolicy().fine(daysOverdue); }
+
+    // Due dates follow from the role's loan period
+    std::time_t dueDate(std::time_t borrowDate) const {
+        return borrowDate + static_cast<std::time_t>(getMaxDays()) * 24 * 60 * 60;
+    }
+    // Due date of the loan due first; 0 without open loans. O(1).
+    std::time_t earliestDueDate() const {
+        std::time_t oldest = account.getOldestOpenLoanDate();
+        return oldest ? dueDate(oldest) : 0;
+    }
+    bool hasLoanOverdueBy(int days, std::time_t now) const {
+        std::time_t due = earliestDueDate();
+        return due != 0 && Utils::calculateDaysDifference(due, now) > days;
+    }
+    // The role stops new loans while one is overdue past its threshold
+    bool isBlockedByOverdue(std::time_t now) const {
+        int days = getPolicy().overdueBlockDays;
+        return days >= 0 && hasLoanOverdueBy(days, now);
+    }
 
     // Serialization
     std::string serialize() const;
-    static User* deserialize(const std::string& data);
+    static User* deserialize(const std::string& data);  // throws std::invalid_argument
+    static std::unique_ptr<User> parse(std::string_view data, ParseError& error);
+    static User* create(UserRole role, std::string name,
+                        std::string email, std::string password);
+    // A stored user, keeping its ID
+    static User* create(UserRole role, Id id, std::string name,
+                        std::string email, std::string password);
 
     friend class Library; // Allow Library to access id
+    friend class Snapshot;
 };
 
 // Inheritance: Student inherits from User
 class Student : public User {
 public:
-    Student(const std::string& name, const std::string& email, 
-            const std::string& password);
-
-    // Polymorphism: Override virtual methods
-    int getMaxBooks() const override;
-    int getMaxDays() const override;
-    double calculateFine(int daysOverdue) const override;
-    bool borrowBook(const std::string& bookId) override;
-    bool returnBook(const std::string& bookId) override;
+    Student(std::string name, std::string email,
+            std::string password);
+    Student(Id id, std::string name, std::string email,
+            std::string password);
 };
 
 // Inheritance: Faculty inherits from User
 class Faculty : public User {
 public:
-    Faculty(const std::string& name, const std::string& email, 
-            const std::string& password);
-
-    // Polymorphism: Different implementation for faculty
-    int getMaxBooks() const override;
-    int getMaxDays() const override;
-    double calculateFine(int) const override;
-    bool borrowBook(const std::string& bookId) override;
-    bool returnBook(const std::string& bookId) override;
+    Faculty(std::string name, std::string email,
+            std::string password);
+    Faculty(Id id, std::string name, std::string email,
+            std::string password);
 };
 
 // Inheritance: Librarian inherits from User
 class Librarian : public User {
 public:
-    Librarian(const std::string& name, const std::string& email, 
-              const std::string& password);
-
-    // Polymorphism: Librarian-specific implementation
-    int getMaxBooks() const override;
-    int getMaxDays() const override;
-    double calculateFine(int) const override;
-    bool borrowBook(const std::string&) override;
-    bool returnBook(const std::string&) override;
+    Librarian(std::string name, std::string email,
+              std::string password);
+    Librarian(Id id, std::string name, std::string email,
+              std::string password);
 };
 
 #endif
\ No newline at end of file
@@ -1,7 +1,14 @@
 #include "utils.hpp"
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdio>
 #include <fstream>
-#include <random>
 #include <sstream>
+#include <thread>
+#include <vector>
 
 std::time_t Utils::getCurrentTime() {
     return std::time(nullptr);
@@ -11,26 +18,36 @@ int Utils::calculateDaysDifference(std::time_t start, std::time_t end) {
     return static_cast<int>(difftime(end, start) / (60 * 60 * 24));
 }
 
-std::string Utils::generateUniqueId() {
-    static std::random_device rd;
-    static std::mt19937 gen(rd());
-    static std::uniform_int_distribution<> dis(0, 35);
-    
-    std::string id;
-    const char chars[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
-    
-    for(int i = 0; i < 8; ++i) {
-        id += chars[dis(gen)];
-    }
-    return id;
+Id Utils::generateUniqueId() {
+    return Id::generate();
 }
 
-void Utils::saveToFile(const std::string& filename, const std::string& content) {
-    std::ofstream file(filename);
-    if (file.is_open()) {
-        file << content;
-        file.close();
-    }
+bool Utils::saveToFile(const std::string& filename, const std::string& content) {
+    // Write a sibling file and rename it over the target, so a crash never
+    // leaves a half-written snapshot behind
+    std::string tempName = filename + ".tmp";
+    std::ofstream file(tempName);
+    if (!file.is_open()) return false;
+    file << content;
+    file.close();
+    if (!file) return false;
+
+    // The data must be on disk before the rename can expose it
+    int fd = ::open(tempName.c_str(), O_RDONLY);
+    bool synced = fd >= 0 && ::fsync(fd) == 0;
+    if (fd >= 0) ::close(fd);
+    if (!synced || std::rename(tempName.c_str(), filename.c_str()) != 0) return false;
+    return syncParentDirectory(filename);
+}
+
+bool Utils::syncParentDirectory(const std::string& path) {
+    std::size_t slash = path.find_last_of('/');
+    std::string dir = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0) return false;
+    bool synced = ::fsync(fd) == 0;
+    ::close(fd);
+    return synced;
 }
 
 std::string Utils::readFromFile(const std::string& filename) {
@@ -42,3 +59,54 @@ std::string Utils::readFromFile(const std::string& filename) {
     }
     return buffer.str();
 }
+
+std::string Utils::normalizeEmail(const std::string& email) {
+    // Trim surrounding whitespace and lower-case so lookups ignore both
+    std::size_t start = email.find_first_not_of(" \t\n\r");
+    if (start == std::string::npos) return "";
+    std::size_t end = email.find_last_not_of(" \t\n\r");
+
+    std::string normalized = email.substr(start, end - start + 1);
+    std::transform(normalized.begin(), normalized.end(), normalized.begin(),
+        [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return normalized;
+}
+
+bool Utils::isNormalizedEmail(const std::string& email) {
+    if (email.empty()) return true;
+    if (std::isspace(static_cast<unsigned char>(email.front())) ||
+        std::isspace(static_cast<unsigned char>(email.back()))) {
+        return false;
+    }
+    return std::none_of(email.begin(), email.end(),
+        [](unsigned char c) { return std::isupper(c); });
+}
+
+std::size_t Utils::workerCount() {
+    unsigned int cores = std::thread::hardware_concurrency();
+    return cores > 0 ? cores : 1;
+}
+
+void Utils::parallelFor(std::size_t count, const std::function<void(std::size_t)>& task) {
+    std::size_t workers = std::min(count, workerCount());
+    if (workers <= 1) {
+        for (std::size_t i = 0; i < count; ++i) task(i);
+        return;
+    }
+
+    // Tasks are handed out dynamically so uneven chunks still balance
+    std::atomic<std::size_t> next(0);
+    auto worker = [&]() {
+        for (std::size_t i = next++; i < count; i = next++) {
+            task(i);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (std::size_t w = 1; w < workers; ++w) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
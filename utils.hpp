@@ -3,14 +3,28 @@
 
 #include <string>
 #include <ctime>
+#include <cstddef>
+#include <functional>
+#include "id.hpp"
 
 class Utils {
 public:
     static std::time_t getCurrentTime();
     static int calculateDaysDifference(std::time_t start, std::time_t end);
-    static std::string generateUniqueId();
-    static void saveToFile(const std::string& filename, const std::string& content);
+    static Id generateUniqueId();
+    // Replace filename atomically and durably; false (nothing replaced, or
+    // the rename not yet on disk) on failure
+    static bool saveToFile(const std::string& filename, const std::string& content);
+    // fsync the directory holding path, so a rename into it survives a crash
+    static bool syncParentDirectory(const std::string& path);
     static std::string readFromFile(const std::string& filename);
+    static std::string normalizeEmail(const std::string& email);
+    // True if normalizeEmail would return email unchanged
+    static bool isNormalizedEmail(const std::string& email);
+
+    // Run task(0..count-1) across up to workerCount() threads
+    static std::size_t workerCount();
+    static void parallelFor(std::size_t count, const std::function<void(std::size_t)>& task);
 };
 
 #endif